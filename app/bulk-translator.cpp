@@ -0,0 +1,266 @@
+/*
+ * bulk-translator.cpp
+ *
+ * Translates a large line-based corpus (--bulk-input) into --bulk-output,
+ * line for line, in a way that survives interruption.
+ *
+ * Input is cut into shards of about --stream-chunk-bytes (1 MiB if not set),
+ * at line breaks, each a request of its own, with at most
+ * --stream-max-requests in flight. Translations are appended to the output in
+ * input order as they complete. Every --bulk-checkpoint-every shards the output
+ * is synced and a checkpoint (<output>.checkpoint) records how far input and
+ * output got. Run again with the same arguments after an interruption, and
+ * translation resumes from the last checkpoint, dropping any output written
+ * after it. The checkpoint is removed once the output is complete, and resuming
+ * is refused if the input changed since the checkpoint was written, or if the
+ * part it is for is split differently (another --bulk-processes).
+ *
+ * With --bulk-processes N, the input is split into N parts at line breaks,
+ * each translated by a process of its own into <output>.part-<i>, with its own
+ * checkpoint, and the parts are joined into the output once all are done.
+ * Model memory loaded before the processes start (--bytearray-shared-memory or
+ * --check-bytearray) is shared among them rather than loaded N times.
+ */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common/logging.h"
+#include "translator/byte_array_util.h"
+#include "translator/parser.h"
+#include "translator/response.h"
+#include "translator/sentence_splitter.h"
+#include "translator/service.h"
+
+namespace {
+
+using marian::bergamot::Response;
+using marian::bergamot::ResponseOptions;
+using marian::bergamot::Service;
+
+/// Progress of translating the part [begin, end) of the input: input consumed
+/// up to byte offset input, whose translation is output bytes of the output
+/// file. inputSize and inputModified identify the version of the input the
+/// offsets refer to.
+struct Checkpoint {
+  size_t inputSize;
+  time_t inputModified;
+  size_t begin;
+  size_t end;
+  size_t input;
+  size_t output;
+};
+
+bool readCheckpoint(const std::string &path, Checkpoint &checkpoint) {
+  std::ifstream file(path);
+  return static_cast<bool>(file >> checkpoint.inputSize >> checkpoint.inputModified >> checkpoint.begin >>
+                           checkpoint.end >> checkpoint.input >> checkpoint.output);
+}
+
+/// Replaces the checkpoint at path atomically, so that an interruption leaves
+/// either the previous checkpoint or this one.
+void writeCheckpoint(const std::string &path, const Checkpoint &checkpoint) {
+  std::string temporary = path + ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::trunc);
+    file << checkpoint.inputSize << ' ' << checkpoint.inputModified << ' ' << checkpoint.begin << ' '
+         << checkpoint.end << ' ' << checkpoint.input << ' ' << checkpoint.output << '\n';
+    ABORT_IF(!file.flush(), "Cannot write checkpoint {}", temporary);
+  }
+  ABORT_IF(std::rename(temporary.c_str(), path.c_str()) != 0, "Cannot write checkpoint {}: {}", path,
+           std::strerror(errno));
+}
+
+void writeFully(int fd, const std::string &data, const std::string &path) {
+  const char *p = data.data();
+  size_t size = data.size();
+  while (size > 0) {
+    ssize_t written = ::write(fd, p, size);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    ABORT_IF(written <= 0, "Cannot write {}: {}", path, std::strerror(errno));
+    p += written;
+    size -= written;
+  }
+}
+
+struct stat fileStatus(const std::string &path) {
+  struct stat status;
+  ABORT_IF(::stat(path.c_str(), &status) != 0, "Cannot read {}: {}", path, std::strerror(errno));
+  return status;
+}
+
+/// Translates the lines of input starting in [begin, end) into output,
+/// resuming from the checkpoint of output if there is one.
+void translatePart(Service &service, const marian::Ptr<marian::Options> &options, const std::string &input,
+                   size_t begin, size_t end, const std::string &output) {
+  size_t shardBytes = options->get<int>("stream-chunk-bytes");
+  shardBytes = shardBytes > 0 ? shardBytes : (1 << 20);
+  size_t maxRequests = std::max<int>(1, options->get<int>("stream-max-requests"));
+  size_t checkpointEvery = std::max<int>(1, options->get<int>("bulk-checkpoint-every"));
+  std::string checkpointPath = output + ".checkpoint";
+
+  std::ifstream in(input, std::ios::binary);
+  ABORT_IF(!in, "Cannot read {}", input);
+
+  // A part starts at the first line starting at or after begin.
+  struct stat status = fileStatus(input);
+  Checkpoint checkpoint{static_cast<size_t>(status.st_size), status.st_mtime, begin, end, begin, 0};
+  bool resumed = readCheckpoint(checkpointPath, checkpoint);
+  if (resumed) {
+    ABORT_IF(checkpoint.inputSize != static_cast<size_t>(status.st_size) || checkpoint.inputModified != status.st_mtime,
+             "{} changed since checkpoint {} was written; remove the checkpoint to translate it from the start",
+             input, checkpointPath);
+    ABORT_IF(checkpoint.begin != begin || checkpoint.end != end,
+             "Checkpoint {} is for bytes [{}, {}) of {}, not [{}, {}); run with the --bulk-processes it was written "
+             "with, or remove it to translate the part from the start",
+             checkpointPath, checkpoint.begin, checkpoint.end, input, begin, end);
+    LOG(info, "Resuming {} at input byte {}", output, checkpoint.input);
+    in.seekg(checkpoint.input);
+  } else if (begin > 0) {
+    in.seekg(begin - 1);
+    std::string rest;
+    std::getline(in, rest);
+    checkpoint.input = begin + rest.size();
+  }
+
+  // Output after the checkpoint is from shards that are translated again.
+  int fd = ::open(output.c_str(), O_WRONLY | O_CREAT, 0644);
+  ABORT_IF(fd < 0, "Cannot open {}: {}", output, std::strerror(errno));
+  ABORT_IF(::ftruncate(fd, checkpoint.output) != 0 || ::lseek(fd, checkpoint.output, SEEK_SET) < 0,
+           "Cannot resume {}: {}", output, std::strerror(errno));
+
+  // Each shard in flight, with the input offset it ends at.
+  std::deque<std::pair<std::future<Response>, size_t>> inFlight;
+  size_t sinceCheckpoint = 0;
+  auto complete = [&]() {
+    Response response = inFlight.front().first.get();
+    writeFully(fd, response.target.text, output);
+    checkpoint.input = inFlight.front().second;
+    checkpoint.output += response.target.text.size();
+    inFlight.pop_front();
+    if (++sinceCheckpoint == checkpointEvery) {
+      ABORT_IF(::fsync(fd) != 0, "Cannot sync {}: {}", output, std::strerror(errno));
+      writeCheckpoint(checkpointPath, checkpoint);
+      sinceCheckpoint = 0;
+    }
+  };
+
+  size_t offset = checkpoint.input;
+  std::string shard;
+  std::string line;
+  while (offset < end && std::getline(in, line)) {
+    offset += line.size();
+    shard += line;
+    if (!in.eof()) {
+      shard += '\n';
+      offset += 1;
+    }
+    if (shard.size() >= shardBytes || offset >= end || in.peek() == EOF) {
+      if (inFlight.size() == maxRequests) {
+        complete();
+      }
+      inFlight.emplace_back(service.translate(std::move(shard), ResponseOptions()), offset);
+      shard.clear();
+    }
+  }
+  while (!inFlight.empty()) {
+    complete();
+  }
+
+  ABORT_IF(::fsync(fd) != 0, "Cannot sync {}: {}", output, std::strerror(errno));
+  ::close(fd);
+  writeCheckpoint(checkpointPath, checkpoint);
+}
+
+marian::bergamot::MemoryBundle loadMemoryBundle(const marian::Ptr<marian::Options> &options) {
+  std::string sharedMemoryName = options->get<std::string>("bytearray-shared-memory");
+  if (!sharedMemoryName.empty()) {
+    return marian::bergamot::getMemoryBundleFromSharedMemory(options, sharedMemoryName);
+  } else if (options->get<bool>("check-bytearray")) {
+    return marian::bergamot::getMemoryBundleFromConfig(options);
+  }
+  return {};
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  auto cp = marian::bergamot::createConfigParser();
+  cp.addOption<std::string>("--bulk-input", "Bulk Options", "Line-based text file to translate.", "");
+  cp.addOption<std::string>("--bulk-output", "Bulk Options", "File to write the translation to, line for line.", "");
+  cp.addOption<int>("--bulk-processes", "Bulk Options", "Number of processes to split the input among.", 1);
+  cp.addOption<int>("--bulk-checkpoint-every", "Bulk Options",
+                    "Number of shards translated between checkpoints of the output.", 16);
+  auto options = cp.parseOptions(argc, argv, true);
+
+  std::string input = options->get<std::string>("bulk-input");
+  std::string output = options->get<std::string>("bulk-output");
+  ABORT_IF(input.empty() || output.empty(), "Give --bulk-input and --bulk-output");
+  ABORT_IF(!marian::bergamot::lineBreakEndsParagraph(options->get<std::string>("ssplit-mode")),
+           "Translation is line for line, which wrapped_text does not keep; use ssplit-mode paragraph or sentence");
+
+  size_t size = fileStatus(input).st_size;
+  size_t processes = std::max<int>(1, options->get<int>("bulk-processes"));
+
+  // Loaded before forking, so that processes share the pages.
+  marian::bergamot::MemoryBundle memoryBundle = loadMemoryBundle(options);
+
+  if (processes == 1) {
+    Service service(options, std::move(memoryBundle));
+    translatePart(service, options, input, 0, size, output);
+    std::remove((output + ".checkpoint").c_str());
+    return 0;
+  }
+
+  // Services start threads, so they are only constructed in the children.
+  std::vector<pid_t> children;
+  for (size_t part = 0; part < processes; part++) {
+    pid_t pid = ::fork();
+    ABORT_IF(pid < 0, "Cannot start process: {}", std::strerror(errno));
+    if (pid == 0) {
+      Service service(options, std::move(memoryBundle));
+      translatePart(service, options, input, size * part / processes, size * (part + 1) / processes,
+                    output + ".part-" + std::to_string(part));
+      std::exit(0);
+    }
+    children.push_back(pid);
+  }
+
+  bool failed = false;
+  for (pid_t pid : children) {
+    int status;
+    ::waitpid(pid, &status, 0);
+    failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+  }
+  ABORT_IF(failed, "Some parts failed; run again to resume them");
+
+  std::ofstream joined(output, std::ios::binary | std::ios::trunc);
+  for (size_t part = 0; part < processes; part++) {
+    std::string partPath = output + ".part-" + std::to_string(part);
+    std::ifstream partFile(partPath, std::ios::binary);
+    joined << partFile.rdbuf();
+  }
+  ABORT_IF(!joined.flush(), "Cannot write {}", output);
+  for (size_t part = 0; part < processes; part++) {
+    std::string partPath = output + ".part-" + std::to_string(part);
+    std::remove(partPath.c_str());
+    std::remove((partPath + ".checkpoint").c_str());
+  }
+  return 0;
+}
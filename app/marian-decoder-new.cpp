@@ -13,6 +13,7 @@
 #include "translator/parser.h"
 #include "translator/response.h"
 #include "translator/service.h"
+#include "translator/stream_translator.h"
 
 void marian_decoder_minimal(const marian::bergamot::Response &response,
                             marian::Ptr<marian::Options> options) {
@@ -28,6 +29,17 @@ int main(int argc, char *argv[]) {
   marian::timer::Timer decoderTimer;
 
   marian::bergamot::Service service(options);
+
+  if (options->get<int>("stream-chunk-bytes") > 0) {
+    // Translate stdin chunk by chunk, printing each as it completes.
+    marian::bergamot::translateStream(service, options, std::cin, marian::bergamot::ResponseOptions(),
+                                      [&options](marian::bergamot::Response &&response) {
+                                        marian_decoder_minimal(response, options);
+                                      });
+    LOG(info, "Total time: {:.5f}s wall", decoderTimer.elapsed());
+    return 0;
+  }
+
   // Read a large input text blob from stdin
   std::ostringstream std_input;
   std_input << std::cin.rdbuf();
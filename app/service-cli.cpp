@@ -11,39 +11,10 @@
 #include "translator/response.h"
 #include "translator/response_options.h"
 #include "translator/service.h"
+#include "translator/stream_translator.h"
 
-int main(int argc, char *argv[]) {
-  auto cp = marian::bergamot::createConfigParser();
-  auto options = cp.parseOptions(argc, argv, true);
-
-  // Prepare memories for bytearrays (including model, shortlist and vocabs)
-  marian::bergamot::MemoryBundle memoryBundle;
-
-  if (options->get<bool>("check-bytearray")) {
-    // Load legit values into bytearrays.
-    memoryBundle = marian::bergamot::getMemoryBundleFromConfig(options);
-  }
-
-  marian::bergamot::Service service(options, std::move(memoryBundle));
-
-  // Read a large input text blob from stdin
-  std::ostringstream std_input;
-  std_input << std::cin.rdbuf();
-  std::string input = std_input.str();
-  using marian::bergamot::Response;
-
-  marian::bergamot::ResponseOptions responseOptions;
-  responseOptions.qualityScores = true;
-  responseOptions.alignment = true;
-  responseOptions.alignmentThreshold = 0.2f;
-
-  // Wait on future until Response is complete
-  std::future<Response> responseFuture =
-      service.translate(std::move(input), responseOptions);
-  responseFuture.wait();
-  Response response = responseFuture.get();
-
-  std::cout << "[original]: " << response.source.text << '\n';
+void printResponse(const marian::bergamot::Response &response) {
+  std::cout << "[original]: " << response.source.view() << '\n';
   std::cout << "[translated]: " << response.target.text << '\n';
   for (int sentenceIdx = 0; sentenceIdx < response.size(); sentenceIdx++) {
     std::cout << " [src Sentence]: " << response.source.sentence(sentenceIdx)
@@ -92,6 +63,60 @@ int main(int argc, char *argv[]) {
   }
   std::cout << "--------------------------\n";
   std::cout << '\n';
+}
 
+void translateInput(marian::bergamot::Service &service, const marian::Ptr<marian::Options> &options) {
+  marian::bergamot::ResponseOptions responseOptions;
+  responseOptions.qualityScores = true;
+  responseOptions.alignment = true;
+  responseOptions.alignmentThreshold = 0.2f;
+
+  if (options->get<int>("stream-chunk-bytes") > 0) {
+    // Translate stdin chunk by chunk, printing each as it completes.
+    marian::bergamot::translateStream(service, options, std::cin, responseOptions, printResponse);
+    return;
+  }
+
+  // Read a large input text blob from stdin
+  std::ostringstream std_input;
+  std_input << std::cin.rdbuf();
+  std::string input = std_input.str();
+  using marian::bergamot::Response;
+
+  // Wait on future until Response is complete
+  std::future<Response> responseFuture =
+      service.translate(std::move(input), responseOptions);
+  responseFuture.wait();
+  Response response = responseFuture.get();
+  printResponse(response);
+}
+
+int main(int argc, char *argv[]) {
+  auto cp = marian::bergamot::createConfigParser();
+  cp.addOption<bool>("--unlink-shared-memory", "Bergamot Options",
+                     "Remove the shared memory segments named by --bytearray-shared-memory on exit. Processes still "
+                     "using them are not affected; the next process to start loads the files anew. Without it, the "
+                     "segments stay for later processes until removed or the machine restarts.",
+                     false);
+  auto options = cp.parseOptions(argc, argv, true);
+
+  // Prepare memories for bytearrays (including model, shortlist and vocabs)
+  marian::bergamot::MemoryBundle memoryBundle;
+
+  std::string sharedMemoryName = options->get<std::string>("bytearray-shared-memory");
+  if (!sharedMemoryName.empty()) {
+    // Load bytearrays into (or attach to) memory shared with other processes.
+    memoryBundle = marian::bergamot::getMemoryBundleFromSharedMemory(options, sharedMemoryName);
+  } else if (options->get<bool>("check-bytearray")) {
+    // Load legit values into bytearrays.
+    memoryBundle = marian::bergamot::getMemoryBundleFromConfig(options);
+  }
+
+  marian::bergamot::Service service(options, std::move(memoryBundle));
+  translateInput(service, options);
+
+  if (!sharedMemoryName.empty() && options->get<bool>("unlink-shared-memory")) {
+    marian::bergamot::unlinkSharedMemoryBundle(sharedMemoryName);
+  }
   return 0;
 }
@@ -0,0 +1,352 @@
+/*
+ * translation-server.cpp
+ *
+ * A long-running server which keeps models loaded and translates requests
+ * from any number of local clients, over a Unix domain socket
+ * (--server-socket) or a TCP port on the loopback interface (--server-port).
+ *
+ * Clients send framed requests and may send further requests without waiting
+ * for responses. Each response is sent back as soon as it is translated, so
+ * responses arrive in any order, tagged with the id of their request. All
+ * integers are little-endian.
+ *
+ *   request:  uint32 size of the rest of the frame
+ *             uint32 id, chosen by the client
+ *             uint8  flags: 1 quality scores, 2 alignments, 4 HTML
+ *             uint8  length of the model name, and the name (empty for the
+ *                    default model)
+ *             text to translate
+ *
+ *   response: uint32 size of the rest of the frame
+ *             uint32 id of the request
+ *             uint8  status: 0 ok, followed by the Response as serialized by
+ *                    serializeResponse() (see FlatResponse); 1 error,
+ *                    followed by a message
+ *
+ * A connection is served until the client closes it, after which outstanding
+ * responses are still sent. At most kMaxOutstanding requests of a connection
+ * are translated or waiting to be sent at once; further requests are read once
+ * earlier responses have gone out.
+ *
+ * Each model is a Service with workers of its own. So that N models do not
+ * start N times --cpu-threads workers, the threads given by --cpu-threads are
+ * divided among the models, overriding what their configs ask for.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "common/logging.h"
+#include "translator/flat_response.h"
+#include "translator/parser.h"
+#include "translator/response_options.h"
+#include "translator/service.h"
+
+namespace {
+
+using marian::bergamot::Response;
+using marian::bergamot::ResponseOptions;
+using marian::bergamot::Service;
+
+/// Requests larger than this are refused and the connection closed, so that a
+/// bad length cannot make the server allocate without bound.
+const size_t kMaxFrameSize = 256 << 20;
+
+/// Requests of a connection translated or waiting to be sent at once. Reading
+/// pauses at this many, so that a client pipelining requests faster than they
+/// are translated (or not reading responses) cannot exhaust memory.
+const size_t kMaxOutstanding = 64;
+
+enum RequestFlags { QUALITY_SCORES = 1, ALIGNMENT = 2, HTML = 4 };
+
+enum ResponseStatus { OK = 0, ERROR = 1 };
+
+/// Reads exactly size bytes. Returns false on end of stream or error.
+bool readFully(int fd, char *data, size_t size) {
+  while (size > 0) {
+    ssize_t got = ::read(fd, data, size);
+    if (got < 0 && errno == EINTR) {
+      continue;
+    }
+    if (got <= 0) {
+      return false;
+    }
+    data += got;
+    size -= got;
+  }
+  return true;
+}
+
+/// Writes all of data. Returns false on error, e.g. if the client is gone.
+bool writeFully(int fd, const char *data, size_t size) {
+  while (size > 0) {
+    ssize_t written = ::send(fd, data, size, MSG_NOSIGNAL);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+uint32_t readUint32(const char *data) {
+  uint32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+void appendUint32(std::string &frame, uint32_t value) {
+  frame.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+/// Starts a response frame for request id, leaving the size to be set by
+/// finishFrame().
+std::string startFrame(uint32_t id, ResponseStatus status) {
+  std::string frame;
+  appendUint32(frame, 0);
+  appendUint32(frame, id);
+  frame.push_back(static_cast<char>(status));
+  return frame;
+}
+
+void finishFrame(std::string &frame) {
+  uint32_t size = frame.size() - sizeof(uint32_t);
+  std::memcpy(&frame[0], &size, sizeof(size));
+}
+
+/// A client connection. Its reader queues translations; responses are queued
+/// by the callbacks as translations complete, and sent by its writer.
+class Connection : public std::enable_shared_from_this<Connection> {
+ public:
+  Connection(int fd, const std::map<std::string, std::unique_ptr<Service>> &services)
+      : fd_(fd), services_(services) {}
+
+  /// Serves the connection until the client closes it and all responses are
+  /// sent, then closes it.
+  static void serve(std::shared_ptr<Connection> connection) {
+    std::thread writer([connection]() { connection->write(); });
+    connection->read();
+    writer.join();
+    ::close(connection->fd_);
+  }
+
+ private:
+  void read() {
+    std::string frame;
+    char header[sizeof(uint32_t)];
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        room_.wait(lock, [this]() { return inFlight_ + frames_.size() < kMaxOutstanding; });
+      }
+      if (!readFully(fd_, header, sizeof(header))) {
+        break;
+      }
+      size_t size = readUint32(header);
+      if (size > kMaxFrameSize || size < sizeof(uint32_t) + 2) {
+        LOG(warn, "Closing connection sending a malformed request of {} bytes", size);
+        break;
+      }
+      frame.resize(size);
+      if (!readFully(fd_, &frame[0], size)) {
+        break;
+      }
+      queue(frame);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    readerDone_ = true;
+    ready_.notify_one();
+  }
+
+  /// Queues the translation of a request frame, without its size.
+  void queue(const std::string &frame) {
+    uint32_t id = readUint32(frame.data());
+    uint8_t flags = frame[sizeof(uint32_t)];
+    size_t nameLength = static_cast<uint8_t>(frame[sizeof(uint32_t) + 1]);
+    size_t nameBegin = sizeof(uint32_t) + 2;
+    if (nameBegin + nameLength > frame.size()) {
+      send(errorFrame(id, "Malformed request"));
+      return;
+    }
+    std::string name = frame.substr(nameBegin, nameLength);
+    auto service = services_.find(name.empty() ? "default" : name);
+    if (service == services_.end()) {
+      send(errorFrame(id, "Unknown model " + name));
+      return;
+    }
+
+    ResponseOptions responseOptions;
+    responseOptions.qualityScores = flags & QUALITY_SCORES;
+    responseOptions.alignment = flags & ALIGNMENT;
+    responseOptions.HTML = flags & HTML;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      inFlight_++;
+    }
+    // The callback runs on a worker thread and only serializes, leaving the
+    // socket to the writer. It keeps the connection alive until it has run.
+    std::shared_ptr<Connection> self = shared_from_this();
+    service->second->translate(
+        frame.substr(nameBegin + nameLength),
+        [self, id](Response &&response) {
+          std::string frame = startFrame(id, OK);
+          marian::bergamot::serializeResponse(response, frame);
+          finishFrame(frame);
+          self->send(std::move(frame), /*completes=*/true);
+        },
+        responseOptions);
+  }
+
+  static std::string errorFrame(uint32_t id, const std::string &message) {
+    std::string frame = startFrame(id, ERROR);
+    frame += message;
+    finishFrame(frame);
+    return frame;
+  }
+
+  void send(std::string &&frame, bool completes = false) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    frames_.push_back(std::move(frame));
+    if (completes) {
+      inFlight_--;
+    }
+    ready_.notify_one();
+  }
+
+  void write() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    bool connected = true;
+    while (true) {
+      ready_.wait(lock, [this]() { return !frames_.empty() || (readerDone_ && inFlight_ == 0); });
+      if (frames_.empty()) {
+        return;
+      }
+      std::string frame = std::move(frames_.front());
+      frames_.pop_front();
+      room_.notify_one();
+      lock.unlock();
+      // Once the client is gone, responses still in flight are dropped.
+      connected = connected && writeFully(fd_, frame.data(), frame.size());
+      lock.lock();
+    }
+  }
+
+  int fd_;
+  const std::map<std::string, std::unique_ptr<Service>> &services_;
+
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  /// Signaled when a frame is taken to be sent, making room for a request.
+  std::condition_variable room_;
+  std::deque<std::string> frames_;
+  size_t inFlight_{0};
+  bool readerDone_{false};
+};
+
+/// Opens the listening socket asked for by options.
+int listenOn(const marian::Ptr<marian::Options> &options) {
+  std::string path = options->get<std::string>("server-socket");
+  int port = options->get<int>("server-port");
+  ABORT_IF(path.empty() == (port == 0), "Give exactly one of --server-socket and --server-port");
+
+  int fd;
+  if (!path.empty()) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    ABORT_IF(path.size() >= sizeof(address.sun_path), "Socket path {} is too long", path);
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ABORT_IF(fd < 0, "Cannot create socket: {}", std::strerror(errno));
+    // A socket file left by a previous run would make bind fail.
+    ::unlink(path.c_str());
+    ABORT_IF(::bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0, "Cannot bind to {}: {}", path,
+             std::strerror(errno));
+  } else {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    ABORT_IF(fd < 0, "Cannot create socket: {}", std::strerror(errno));
+    int reuse = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    ABORT_IF(::bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0, "Cannot bind to port {}: {}",
+             port, std::strerror(errno));
+  }
+  ABORT_IF(::listen(fd, SOMAXCONN) != 0, "Cannot listen: {}", std::strerror(errno));
+  return fd;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  auto cp = marian::bergamot::createConfigParser();
+  cp.addOption<std::string>("--server-socket", "Server Options", "Path of the Unix domain socket to listen on.", "");
+  cp.addOption<int>("--server-port", "Server Options", "TCP port to listen on, on the loopback interface only.", 0);
+  cp.addOption<std::vector<std::string>>("--server-models", "Server Options",
+                                         "Further models to serve, as name=config.yml. Requests name the model to "
+                                         "translate with; the model given by the other options is named default. "
+                                         "--cpu-threads are divided among all models.",
+                                         {});
+  auto options = cp.parseOptions(argc, argv, true);
+
+  // Each Service starts workers of its own, so the threads are divided among
+  // the models rather than each taking all of them.
+  std::vector<std::string> models = options->get<std::vector<std::string>>("server-models");
+  int numModels = models.size() + 1;
+  int threads = std::max<int>(1, options->get<int>("cpu-threads"));
+  int threadsPerModel = std::max<int>(1, threads / numModels);
+  if (threads < numModels) {
+    LOG(warn, "Serving {} models with a worker each, more than the {} --cpu-threads", numModels, threads);
+  }
+
+  std::map<std::string, std::unique_ptr<Service>> services;
+  options->set<int>("cpu-threads", threadsPerModel);
+  services["default"].reset(new Service(options));
+  for (const std::string &model : models) {
+    size_t equals = model.find('=');
+    ABORT_IF(equals == std::string::npos, "Expected name=config.yml in --server-models, got {}", model);
+    std::ifstream file(model.substr(equals + 1));
+    ABORT_IF(!file, "Cannot read {}", model.substr(equals + 1));
+    std::ostringstream config;
+    config << file.rdbuf();
+    marian::Ptr<marian::Options> modelOptions = marian::bergamot::parseOptions(config.str(), /*validate=*/false);
+    modelOptions->set<int>("cpu-threads", threadsPerModel);
+    services[model.substr(0, equals)].reset(new Service(modelOptions));
+  }
+
+  int listener = listenOn(options);
+  LOG(info, "Serving {} model(s)", services.size());
+  while (true) {
+    int fd = ::accept(listener, nullptr, nullptr);
+    if (fd < 0) {
+      ABORT_IF(errno != EINTR && errno != ECONNABORTED, "Cannot accept connections: {}", std::strerror(errno));
+      continue;
+    }
+    auto connection = std::make_shared<Connection>(fd, services);
+    std::thread(Connection::serve, connection).detach();
+  }
+  return 0;
+}
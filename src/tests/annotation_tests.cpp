@@ -212,3 +212,57 @@ TEST_CASE("Test Annotation API with random sentences") {
   std::string obtainedString = std::string(emptyView.data(), emptyView.size());
   CHECK(expectedEmptyString == obtainedString);
 }
+
+TEST_CASE("Test extracting a sentence from AnnotatedText") {
+  AnnotatedText annotatedText(std::string("  Hello world.\n\nSecond  sentence here. "));
+  std::string &text = annotatedText.text;
+
+  std::vector<marian::string_view> first = {marian::string_view(&text[2], 5), marian::string_view(&text[7], 6),
+                                            marian::string_view(&text[13], 1)};
+  annotatedText.recordExistingSentence(first.begin(), first.end(), first.front().data());
+  std::vector<marian::string_view> second = {marian::string_view(&text[16], 6), marian::string_view(&text[22], 10),
+                                             marian::string_view(&text[32], 6)};
+  annotatedText.recordExistingSentence(second.begin(), second.end(), second.front().data());
+
+  for (size_t sentenceIdx = 0; sentenceIdx < annotatedText.numSentences(); sentenceIdx++) {
+    AnnotatedText extracted = annotatedText.extractSentence(sentenceIdx);
+    CHECK(extracted.text == std::string(annotatedText.sentence(sentenceIdx)));
+    CHECK(extracted.numSentences() == 1);
+    CHECK(extracted.gap(0).size() == 0);
+    CHECK(extracted.gap(1).size() == 0);
+    REQUIRE(extracted.numWords(0) == annotatedText.numWords(sentenceIdx));
+    for (size_t wordIdx = 0; wordIdx < extracted.numWords(0); wordIdx++) {
+      CHECK(std::string(extracted.word(0, wordIdx)) == std::string(annotatedText.word(sentenceIdx, wordIdx)));
+    }
+  }
+}
+
+TEST_CASE("Test AnnotatedText on a borrowed buffer") {
+  auto buffer = std::make_shared<std::string>("Hello world. Bye.");
+  std::weak_ptr<std::string> observer = buffer;
+  marian::string_view borrowed(*buffer);
+
+  AnnotatedText annotatedText(borrowed, buffer);
+  buffer.reset();
+  CHECK(!observer.expired());  // AnnotatedText holds on to the buffer.
+  CHECK(annotatedText.isBorrowed());
+  CHECK(annotatedText.text.empty());
+  CHECK(annotatedText.view().data() == borrowed.data());
+
+  std::vector<marian::string_view> first = {borrowed.substr(0, 5), borrowed.substr(5, 6), borrowed.substr(11, 1)};
+  annotatedText.recordExistingSentence(first.begin(), first.end(), first.front().data());
+  std::vector<marian::string_view> second = {borrowed.substr(13, 3), borrowed.substr(16, 1)};
+  annotatedText.recordExistingSentence(second.begin(), second.end(), second.front().data());
+
+  CHECK(annotatedText.numSentences() == 2);
+  CHECK(std::string(annotatedText.sentence(0)) == "Hello world.");
+  CHECK(std::string(annotatedText.sentence(1)) == "Bye.");
+  CHECK(std::string(annotatedText.gap(1)) == " ");
+  CHECK(annotatedText.word(1, 0).data() == borrowed.data() + 13);
+
+  AnnotatedText moved(std::move(annotatedText));
+  CHECK(std::string(moved.word(0, 1)) == " world");
+
+  moved = AnnotatedText();
+  CHECK(observer.expired());
+}
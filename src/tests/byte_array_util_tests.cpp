@@ -0,0 +1,59 @@
+#include <vector>
+
+#include "catch.hpp"
+#include "translator/byte_array_util.h"
+
+using namespace marian::bergamot;
+
+namespace {
+// Fills memory with a deterministic byte pattern.
+AlignedMemory patternedMemory(size_t size) {
+  AlignedMemory memory(size, 256);
+  for (size_t i = 0; i < size; i++) {
+    memory[i] = static_cast<char>((i * 131 + 7) & 0xff);
+  }
+  return memory;
+}
+}  // namespace
+
+TEST_CASE("Checksum matches reference values") {
+  // Reference values are computed independently: xxHash64 of each 1MiB chunk,
+  // followed by xxHash64 of the little-endian chunk hashes.
+  CHECK(computeChecksum(patternedMemory(0)) == 0xef46db3751d8e999ULL);
+  CHECK(computeChecksum(patternedMemory(3)) == 0x44ff41511441c080ULL);
+  CHECK(computeChecksum(patternedMemory(100)) == 0x2249f95b363e1f89ULL);
+  CHECK(computeChecksum(patternedMemory(5 * (1 << 20) + 7)) == 0x8653b02c80c55939ULL);
+}
+
+TEST_CASE("Checksum does not depend on number of threads") {
+  std::vector<size_t> sizes = {31, 32, (1 << 20), (1 << 20) + 12345, 3 * (1 << 20)};
+  for (size_t size : sizes) {
+    AlignedMemory memory = patternedMemory(size);
+    uint64_t serial = computeChecksum(memory, 1);
+    for (size_t numThreads : {2, 4, 16}) {
+      CHECK(computeChecksum(memory, numThreads) == serial);
+    }
+  }
+}
+
+TEST_CASE("Checksum detects corruption") {
+  AlignedMemory memory = patternedMemory(2 * (1 << 20) + 5);
+  uint64_t original = computeChecksum(memory, 4);
+  memory[(1 << 20) + 17] ^= 1;
+  CHECK(computeChecksum(memory, 4) != original);
+}
+
+TEST_CASE("Checksum parsing accepts exactly 16 hexadecimal digits") {
+  uint64_t checksum = 0;
+  CHECK(parseChecksum("8653b02c80c55939", checksum));
+  CHECK(checksum == 0x8653b02c80c55939ULL);
+  CHECK(parseChecksum("00000000000000FF", checksum));
+  CHECK(checksum == 0xffULL);
+
+  // Malformed values leave checksum unchanged.
+  for (const char *malformed : {"", "abcxyz", "8653b02c80c5593", "8653b02c80c559391", "8653b02c80c5593g",
+                                "0x8653b02c80c559", " 8653b02c80c5593", "-653b02c80c55939"}) {
+    CHECK(!parseChecksum(malformed, checksum));
+    CHECK(checksum == 0xffULL);
+  }
+}
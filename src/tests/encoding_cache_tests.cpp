@@ -0,0 +1,63 @@
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "translator/encoding_cache.h"
+
+using namespace marian::bergamot;
+
+namespace {
+// Splits text into ranges at spaces, each space starting a word as in
+// SentencePiece.
+std::vector<marian::string_view> spaceRanges(const std::string &text) {
+  std::vector<marian::string_view> ranges;
+  size_t begin = 0;
+  for (size_t i = 1; i <= text.size(); i++) {
+    if (i == text.size() || text[i] == ' ') {
+      ranges.emplace_back(text.data() + begin, i - begin);
+      begin = i;
+    }
+  }
+  return ranges;
+}
+}  // namespace
+
+TEST_CASE("EncodingCache rebases word ranges onto the sentence looked up") {
+  EncodingCache cache(/*capacity=*/2);
+  std::string first = "a cached sentence";
+  cache.insert(marian::string_view(first), marian::Words(), spaceRanges(first));
+
+  // Same text at a different address.
+  std::string text = "prefix a cached sentence";
+  marian::string_view sentence(text.data() + 7, first.size());
+  marian::Words words;
+  std::vector<marian::string_view> wordRanges;
+  REQUIRE(cache.find(sentence, words, wordRanges));
+  REQUIRE(wordRanges.size() == 3);
+  CHECK(wordRanges[0].data() == text.data() + 7);
+  CHECK(std::string(wordRanges[1]) == " cached");
+  CHECK(std::string(wordRanges[2]) == " sentence");
+
+  CHECK(!cache.find(marian::string_view(text), words, wordRanges));
+  EncodingCache::Stats stats = cache.stats();
+  CHECK(stats.hits == 1);
+  CHECK(stats.misses == 1);
+  CHECK(stats.size == 1);
+}
+
+TEST_CASE("EncodingCache evicts the least recently used sentence") {
+  EncodingCache cache(/*capacity=*/2);
+  std::string a = "a", b = "b", c = "c";
+  marian::Words words;
+  std::vector<marian::string_view> wordRanges;
+
+  cache.insert(marian::string_view(a), marian::Words(), spaceRanges(a));
+  cache.insert(marian::string_view(b), marian::Words(), spaceRanges(b));
+  REQUIRE(cache.find(marian::string_view(a), words, wordRanges));  // b is now least recently used.
+  cache.insert(marian::string_view(c), marian::Words(), spaceRanges(c));
+
+  CHECK(cache.find(marian::string_view(a), words, wordRanges));
+  CHECK(!cache.find(marian::string_view(b), words, wordRanges));
+  CHECK(cache.find(marian::string_view(c), words, wordRanges));
+  CHECK(cache.stats().size == 2);
+}
@@ -0,0 +1,102 @@
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "translator/flat_response.h"
+
+using namespace marian::bergamot;
+
+namespace {
+
+/// Annotates text as TextProcessor would, splitting sentences at line breaks
+/// and words at spaces.
+AnnotatedText annotate(const std::string &text) {
+  AnnotatedText annotated{std::string(text)};
+  const std::string &buffer = annotated.text;
+  size_t begin = buffer.find_first_not_of(" \n");
+  while (begin != std::string::npos) {
+    size_t end = std::min(buffer.find('\n', begin), buffer.size());
+    while (end > begin && buffer[end - 1] == ' ') {
+      end--;
+    }
+    std::vector<marian::string_view> words;
+    size_t wordBegin = begin;
+    for (size_t i = begin + 1; i <= end; i++) {
+      if (i == end || buffer[i] == ' ') {
+        words.emplace_back(buffer.data() + wordBegin, i - wordBegin);
+        wordBegin = i;
+      }
+    }
+    annotated.recordExistingSentence(words.begin(), words.end(), buffer.data() + begin);
+    begin = buffer.find_first_not_of(" \n", end);
+  }
+  return annotated;
+}
+
+void checkSame(const AnnotatedText &expected, const FlatAnnotatedText &actual) {
+  CHECK(actual.view() == expected.view());
+  REQUIRE(actual.numSentences() == expected.numSentences());
+  for (size_t sentenceIdx = 0; sentenceIdx < expected.numSentences(); sentenceIdx++) {
+    CHECK(actual.gap(sentenceIdx) == expected.gap(sentenceIdx));
+    CHECK(actual.sentence(sentenceIdx) == expected.sentence(sentenceIdx));
+    REQUIRE(actual.numWords(sentenceIdx) == expected.numWords(sentenceIdx));
+    for (size_t wordIdx = 0; wordIdx < expected.numWords(sentenceIdx); wordIdx++) {
+      CHECK(actual.word(sentenceIdx, wordIdx) == expected.word(sentenceIdx, wordIdx));
+    }
+  }
+  CHECK(actual.gap(expected.numSentences()) == expected.gap(expected.numSentences()));
+}
+
+}  // namespace
+
+TEST_CASE("FlatResponse reads back a serialized Response") {
+  Response response;
+  response.source = annotate("  Hello big world \nSecond one\n\n");
+  response.target = annotate("Hallo grosse Welt\nZweite\n");
+  response.qualityScores = {Quality{-0.5f, {-0.1f, -0.2f, -0.3f}}, Quality{-1.0f, {-1.0f}}};
+  response.alignments = {{Point{0, 0, 0.9f}, Point{1, 1, 0.8f}, Point{2, 2, 0.7f}}, {Point{1, 0, 0.6f}}};
+
+  // Serialized after other data, as when several are sent in one buffer.
+  std::string buffer = "xyz";
+  serializeResponse(response, buffer);
+  FlatResponse flat(marian::string_view(buffer.data() + 3, buffer.size() - 3));
+
+  REQUIRE(flat.size() == 2);
+  checkSame(response.source, flat.source());
+  checkSame(response.target, flat.target());
+
+  REQUIRE(flat.hasQualityScores());
+  for (size_t sentenceIdx = 0; sentenceIdx < flat.size(); sentenceIdx++) {
+    const Quality &quality = response.qualityScores[sentenceIdx];
+    CHECK(flat.sequenceQuality(sentenceIdx) == quality.sequence);
+    REQUIRE(flat.numWordQualities(sentenceIdx) == quality.word.size());
+    for (size_t wordIdx = 0; wordIdx < quality.word.size(); wordIdx++) {
+      CHECK(flat.wordQuality(sentenceIdx, wordIdx) == quality.word[wordIdx]);
+    }
+  }
+
+  REQUIRE(flat.hasAlignments());
+  for (size_t sentenceIdx = 0; sentenceIdx < flat.size(); sentenceIdx++) {
+    const Alignment &alignment = response.alignments[sentenceIdx];
+    REQUIRE(flat.numPoints(sentenceIdx) == alignment.size());
+    for (size_t pointIdx = 0; pointIdx < alignment.size(); pointIdx++) {
+      Point point = flat.point(sentenceIdx, pointIdx);
+      CHECK(point.src == alignment[pointIdx].src);
+      CHECK(point.tgt == alignment[pointIdx].tgt);
+      CHECK(point.prob == alignment[pointIdx].prob);
+    }
+  }
+}
+
+TEST_CASE("FlatResponse of an empty Response") {
+  Response response;
+  response.source = AnnotatedText(std::string(" "));
+  std::string buffer;
+  serializeResponse(response, buffer);
+  FlatResponse flat(buffer);
+  CHECK(flat.size() == 0);
+  CHECK(flat.source().gap(0) == " ");
+  CHECK(flat.target().view().empty());
+  CHECK(!flat.hasQualityScores());
+  CHECK(!flat.hasAlignments());
+}
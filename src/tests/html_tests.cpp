@@ -0,0 +1,102 @@
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "translator/html.h"
+
+using namespace marian::bergamot;
+
+namespace {
+
+/// Annotates text as TextProcessor would: sentences are separated by line
+/// breaks, and words start at spaces and full stops.
+AnnotatedText annotate(const std::string &text) {
+  AnnotatedText annotated{std::string(text)};
+  const std::string &buffer = annotated.text;
+  size_t begin = 0;
+  while (begin < buffer.size()) {
+    begin = buffer.find_first_not_of(" \n", begin);
+    if (begin == std::string::npos) {
+      break;
+    }
+    size_t end = std::min(buffer.find('\n', begin), buffer.size());
+    std::vector<marian::string_view> words;
+    size_t wordBegin = begin;
+    for (size_t i = begin + 1; i <= end; i++) {
+      if (i == end || buffer[i] == ' ' || buffer[i] == '.') {
+        words.emplace_back(buffer.data() + wordBegin, i - wordBegin);
+        wordBegin = i;
+      }
+    }
+    annotated.recordExistingSentence(words.begin(), words.end(), buffer.data() + begin);
+    begin = end;
+  }
+  return annotated;
+}
+
+/// Response translating text into itself, word for word.
+Response identity(const std::string &text) {
+  Response response;
+  response.source = annotate(text);
+  for (size_t sentenceIdx = 0; sentenceIdx < response.source.numSentences(); sentenceIdx++) {
+    std::vector<marian::string_view> words;
+    Alignment alignment;
+    for (size_t wordIdx = 0; wordIdx < response.source.numWords(sentenceIdx); wordIdx++) {
+      words.push_back(response.source.word(sentenceIdx, wordIdx));
+      alignment.push_back(Point{static_cast<WordIndex>(wordIdx), static_cast<WordIndex>(wordIdx), 1.0f});
+    }
+    response.target.appendSentence(response.source.gap(sentenceIdx), words.begin(), words.end());
+    response.alignments.push_back(alignment);
+  }
+  response.target.appendEndingWhitespace(response.source.gap(response.source.numSentences()));
+  return response;
+}
+
+}  // namespace
+
+TEST_CASE("HTML strips markup and restores it around an identity translation") {
+  const std::string original =
+      "<!DOCTYPE html><p class=\"a>b\">Hello <b>world</b>.</p>\n"
+      "<p>Second &amp; <i>last</i><br>line.</p><script>if (a < b) {}</script>";
+  std::string text = original;
+  HTML html(text);
+  CHECK(text == "Hello world.\n\n\nSecond & last\n\nline.\n\n");
+
+  Response response = identity(text);
+  REQUIRE(response.source.numSentences() == 3);
+  html.restore(response);
+
+  CHECK(response.target.text == original);
+  CHECK(response.source.text == original);
+  CHECK(response.source.numSentences() == 3);
+  CHECK(std::string(response.source.sentence(0)) == "Hello <b>world</b>.");
+  CHECK(std::string(response.source.sentence(1)) == "Second &amp; <i>last");
+  CHECK(std::string(response.source.word(1, 1)) == " &amp;");
+}
+
+TEST_CASE("HTML places tags in the translation using alignments") {
+  std::string text = "<b>Hello</b> world";
+  HTML html(text);
+  CHECK(text == "Hello world");
+
+  Response response;
+  response.source = annotate(text);
+  std::string translation = "mundo hola";
+  std::vector<marian::string_view> words = {marian::string_view(translation.data(), 5),
+                                            marian::string_view(translation.data() + 5, 5)};
+  response.target.appendSentence("", words.begin(), words.end());
+  response.target.appendEndingWhitespace("");
+  response.alignments.push_back({Point{1, 0, 0.9f}, Point{0, 1, 0.8f}, Point{1, 1, 0.1f}});
+  html.restore(response);
+
+  CHECK(response.target.text == "mundo <b>hola</b>");
+  CHECK(std::string(response.target.word(0, 1)) == " <b>hola</b>");
+}
+
+TEST_CASE("HTML decodes character references and skips script and style in any case") {
+  std::string text =
+      "<p>Caf&eacute; &mdash; &#233;&#x00E9; &amp; &unknown; &amp no</p>"
+      "<SCRIPT>a = '</p>';</Script>x<style>p {}</STYLE>y<script></script>z";
+  HTML html(text);
+  CHECK(text == "Caf\xC3\xA9 \xE2\x80\x94 \xC3\xA9\xC3\xA9 & &unknown; &amp no\n\nxyz");
+}
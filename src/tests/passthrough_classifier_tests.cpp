@@ -0,0 +1,57 @@
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "translator/passthrough_classifier.h"
+
+using namespace marian::bergamot;
+
+namespace {
+
+/// Classifies each of sentences on its own with a classifier passing through
+/// the given kinds.
+std::vector<bool> classify(const std::vector<std::string> &kinds, const std::vector<std::string> &sentences) {
+  marian::Ptr<marian::Options> options = marian::New<marian::Options>();
+  options->set("skip-translation", kinds);
+  PassthroughClassifier classifier(options);
+
+  std::vector<bool> passthrough;
+  for (const std::string &sentence : sentences) {
+    AnnotatedText source{std::string(sentence)};
+    std::vector<marian::string_view> words = {marian::string_view(source.text)};
+    source.recordExistingSentence(words.begin(), words.end(), source.text.data());
+    std::vector<bool> classified = classifier.classify(source);
+    REQUIRE(classified.size() == 1);
+    passthrough.push_back(classified[0]);
+  }
+  CHECK(classifier.stats().sentences == sentences.size());
+  return passthrough;
+}
+
+}  // namespace
+
+TEST_CASE("PassthroughClassifier passes through the kinds asked for") {
+  const std::vector<std::string> sentences = {
+      "$1,234.50",    "+44 (0)20 7946 0958", "https://example.org/a?b=c", "www.example.org.",
+      "ann@mail.org", "parseHTML()",         "std::vector",               "max_length_break",
+      "Hello world.", "Call me at 12.",      "Http",                      "@home",
+      "-",            "camel",               "a@b",                       "Über_alles"};
+
+  SECTION("numbers") {
+    std::vector<bool> expected = {1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    CHECK(classify({"numbers"}, sentences) == expected);
+  }
+
+  SECTION("urls, emails and identifiers") {
+    std::vector<bool> expected = {0, 0, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0};
+    CHECK(classify({"urls", "emails", "identifiers"}, sentences) == expected);
+  }
+
+  SECTION("disabled") {
+    marian::Ptr<marian::Options> options = marian::New<marian::Options>();
+    PassthroughClassifier classifier(options);
+    CHECK(!classifier.enabled());
+    AnnotatedText source{std::string("42")};
+    CHECK(classifier.classify(source).empty());
+  }
+}
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "translator/pivot_response_builder.h"
+
+using namespace marian::bergamot;
+
+namespace {
+
+/// Annotates text as TextProcessor would, splitting sentences at line breaks
+/// and words at spaces.
+AnnotatedText annotate(const std::string &text) {
+  AnnotatedText annotated{std::string(text)};
+  const std::string &buffer = annotated.text;
+  size_t begin = buffer.find_first_not_of(" \n");
+  while (begin != std::string::npos) {
+    size_t end = std::min(buffer.find('\n', begin), buffer.size());
+    std::vector<marian::string_view> words;
+    size_t wordBegin = begin;
+    for (size_t i = begin + 1; i <= end; i++) {
+      if (i == end || buffer[i] == ' ') {
+        words.emplace_back(buffer.data() + wordBegin, i - wordBegin);
+        wordBegin = i;
+      }
+    }
+    annotated.recordExistingSentence(words.begin(), words.end(), buffer.data() + begin);
+    begin = buffer.find_first_not_of(" \n", end);
+  }
+  return annotated;
+}
+
+}  // namespace
+
+TEST_CASE("PivotResponseBuilder composes a second hop split into sentences") {
+  // "x y" is translated to the pivot "p q", which the second hop splits into
+  // "p" and "q", translated to "s" and "t". Indices one past the words are
+  // end-of-sentence tokens.
+  Response firstHop;
+  firstHop.source = annotate("x y");
+  firstHop.target = annotate("p q");
+  firstHop.alignments = {{{0, 0, 0.9f}, {1, 1, 0.8f}, {2, 2, 1.0f}}};
+  firstHop.qualityScores = {{-1.0f, {-0.5f, -1.5f}}};
+
+  Response secondHop;
+  secondHop.source = annotate("p\nq");
+  secondHop.target = annotate("s\nt");
+  // The point on the target end-of-sentence token of "s" would fall on "t"
+  // if offset as a word.
+  secondHop.alignments = {{{0, 0, 0.5f}, {0, 1, 0.4f}, {1, 1, 1.0f}}, {{0, 0, 0.5f}, {1, 1, 1.0f}}};
+  secondHop.qualityScores = {{-2.0f, {-2.0f}}, {-4.0f, {-4.0f}}};
+
+  ResponseOptions responseOptions;
+  responseOptions.alignment = true;
+  responseOptions.qualityScores = true;
+
+  Response response;
+  bool called = false;
+  PivotResponseBuilder builder(annotate("x y"), responseOptions, [&](Response &&built) {
+    response = std::move(built);
+    called = true;
+  });
+  builder.add(0, std::move(firstHop), std::move(secondHop));
+  REQUIRE(called);
+
+  CHECK(response.target.numSentences() == 1);
+  CHECK(response.target.numWords(0) == 2);
+
+  REQUIRE(response.alignments.size() == 1);
+  const Alignment &alignment = response.alignments[0];
+  REQUIRE(alignment.size() == 2);
+  CHECK(alignment[0].src == 0);
+  CHECK(alignment[0].tgt == 0);
+  CHECK(alignment[0].prob == Approx(0.45f));
+  CHECK(alignment[1].src == 1);
+  CHECK(alignment[1].tgt == 1);
+  CHECK(alignment[1].prob == Approx(0.4f));
+
+  REQUIRE(response.qualityScores.size() == 1);
+  // The first hop's score plus the average of the second hop's.
+  CHECK(response.qualityScores[0].sequence == Approx(-4.0f));
+  CHECK(response.qualityScores[0].word == std::vector<float>{-2.0f, -4.0f});
+}
@@ -0,0 +1,58 @@
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "translator/completion_executor.h"
+#include "translator/request.h"
+#include "translator/response_builder.h"
+
+using namespace marian::bergamot;
+
+TEST_CASE("Request keeps its owner until its queued completion has run") {
+  // As after Service::reload(), the model a Request was made on, here just
+  // its vocabs, is released while the Request's completion is still queued.
+  std::string vocabPath = "request_tests_vocab.yml";
+  std::ofstream(vocabPath) << "</s>: 0\n<unk>: 1\n";
+  marian::Ptr<marian::Options> options = marian::New<marian::Options>();
+  options->set("vocabs", std::vector<std::string>{vocabPath, vocabPath});
+  auto vocabs = std::make_shared<Vocabs>(options, std::vector<std::shared_ptr<AlignedMemory>>());
+  std::weak_ptr<Vocabs> released = vocabs;
+
+  std::string translated;
+  bool ownerHeld = false;
+  {
+    CompletionExecutor executor(/*numThreads=*/1);
+    // Occupies the executor's thread, so that the completion stays queued.
+    std::promise<void> unblock;
+    std::shared_future<void> blocked = unblock.get_future().share();
+    executor.submit([blocked]() { blocked.wait(); });
+
+    AnnotatedText source(std::string("1234"));
+    std::vector<marian::string_view> words = {marian::string_view(source.text)};
+    source.recordExistingSentence(words.begin(), words.end(), source.text.data());
+    ResponseBuilder responseBuilder(ResponseOptions(), std::move(source), *vocabs, [&](Response &&response) {
+      translated = response.target.text;
+      ownerHeld = !released.expired();
+    });
+
+    Segments segments(1);
+    auto request = marian::New<Request>(/*Id=*/0, std::move(segments), std::move(responseBuilder));
+    request->setCompletionExecutor(&executor, vocabs);
+    // A null history is passed through, which completes the Request.
+    request->processHistory(0, nullptr);
+    request.reset();
+    vocabs.reset();
+    CHECK(!released.expired());
+
+    unblock.set_value();
+  }
+
+  CHECK(translated == "1234");
+  CHECK(ownerHeld);
+  CHECK(released.expired());
+  std::remove(vocabPath.c_str());
+}
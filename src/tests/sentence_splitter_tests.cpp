@@ -0,0 +1,102 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "translator/sentence_splitter.h"
+
+using namespace marian::bergamot;
+
+namespace {
+
+/// Texts covering the rules of the splitter: nonbreaking and numeric-only
+/// prefixes, acronyms, ellipses, quotes and brackets around boundaries (also
+/// spaced apart from them), non-ASCII upper case, and line breaks in each mode.
+const std::vector<std::string> kCorpus = {
+    "Hello world. This is a test.",
+    "Mr. Smith went home. He slept.",
+    "Is it? Yes! Sure. no. Why?! Because.",
+    "Is it? no. Is it? 42.",
+    "See No. 5 here. And No. More. No. \"6\" too.",
+    "The U.S. Army is big. The U.S.-A. Corps too. Right.",
+    "He said \"Stop.\" Then he left. (Really.) [Yes.] 'No.' Done.",
+    "Wait... What? 3.14 is pi. 42 is it... 7 more.",
+    "Mr. \"Smith\" came. Dr. (Jones) too. e.g. Python.",
+    "Él vino. Ángel también. éxito. Это тест. Второй тест. Ωmega. «Quoted.» «Next.»",
+    "Trailing full stop without space.Next word. Dots.in.words. Ok.",
+    "Unterminated sentence",
+    "  Leading and trailing whitespace.   Second.  ",
+    "One line. Two\nSecond line. Three\n\nThird paragraph. Four\n \t\nFifth. Six.",
+    "\n\n\nOnly after empty lines.\n\n",
+    "He said \"Stop. \" Then he left. It ended. ( Then more. ) Done.",
+    "Mr. ( Smith ) left. No. ( 5 ) too.",
+    "Fin. \u01C4emal came. \u24B6 is round. \u2E02Quoted.\u2E03 Next.",
+    "",
+};
+
+const std::vector<std::string> kModes = {"sentence", "paragraph", "wrapped_text"};
+
+std::vector<std::string> split(SentenceSplitter &splitter, const std::string &text) {
+  SentenceStream stream = splitter.createSentenceStream(marian::string_view(text.data(), text.size()));
+  std::vector<std::string> sentences;
+  std::string_view sentence;
+  while (stream >> sentence) {
+    sentences.emplace_back(sentence);
+  }
+  return sentences;
+}
+
+}  // namespace
+
+TEST_CASE("Native sentence splitter agrees with ssplit") {
+  std::string prefixFile = "sentence_splitter_tests.nonbreaking_prefix";
+  {
+    std::ofstream out(prefixFile);
+    out << "# Comment\n\nMr\nDr\ne.g\nNo #NUMERIC_ONLY#\n";
+  }
+
+  for (const std::string &mode : kModes) {
+    marian::Ptr<marian::Options> options = marian::New<marian::Options>();
+    options->set("ssplit-mode", mode);
+    options->set("ssplit-prefix-file", prefixFile);
+    options->set("ssplit-backend", std::string("ssplit"));
+    SentenceSplitter ssplit(options);
+    options->set("ssplit-backend", std::string("native"));
+    SentenceSplitter native(options);
+
+    for (const std::string &text : kCorpus) {
+      INFO("mode " << mode << ", text: " << text);
+      CHECK(split(native, text) == split(ssplit, text));
+    }
+  }
+  std::remove(prefixFile.c_str());
+}
+
+TEST_CASE("Native sentence splitter boundaries") {
+  NativeSentenceSplitter splitter;
+  splitter.prefixes().add("Mr", NonbreakingPrefixes::ALWAYS);
+  splitter.prefixes().add("No", NonbreakingPrefixes::NUMERIC_ONLY);
+
+  auto split = [&splitter](const std::string &text) {
+    NativeSentenceStream stream(text, splitter, ONE_PARAGRAPH_PER_LINE);
+    std::vector<std::string> sentences;
+    std::string_view sentence;
+    while (stream >> sentence) {
+      sentences.emplace_back(sentence);
+    }
+    return sentences;
+  };
+
+  CHECK(split("Mr. Smith left. He slept.") == std::vector<std::string>{"Mr. Smith left.", "He slept."});
+  CHECK(split("See No. 5 and No. More.") == std::vector<std::string>{"See No. 5 and No.", "More."});
+  CHECK(split("The U.S. Army. Is it? no.") == std::vector<std::string>{"The U.S. Army.", "Is it? no."});
+  CHECK(split("He said \"Stop.\" Then left.") == std::vector<std::string>{"He said \"Stop.\"", "Then left."});
+  CHECK(split("He said \"Stop. \" Then left.") == std::vector<std::string>{"He said \"Stop. \"", "Then left."});
+  CHECK(split("It ended. ( Then more. ) Done.") ==
+        std::vector<std::string>{"It ended.", "( Then more. )", "Done."});
+  // Upper case outside the Latin, Greek and Cyrillic scripts: a Latin capital
+  // dz digraph, a circled letter. Initial and final punctuation beyond quotes.
+  CHECK(split("Fin. \u01C4emal came. \u24B6 is round. \u2E02Quoted.\u2E03 Next.") ==
+        std::vector<std::string>{"Fin.", "\u01C4emal came.", "\u24B6 is round.", "\u2E02Quoted.\u2E03", "Next."});
+}
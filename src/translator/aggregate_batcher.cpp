@@ -0,0 +1,43 @@
+#include "aggregate_batcher.h"
+
+#include <algorithm>
+
+#include "translation_model.h"
+
+namespace marian {
+namespace bergamot {
+
+size_t AggregateBatcher::addWholeRequest(Ptr<TranslationModel> model, Ptr<Request> request) {
+  model->enqueueRequest(request);
+  if (std::find(queue_.begin(), queue_.end(), model) == queue_.end()) {
+    queue_.push_back(model);
+  }
+  return request->pendingSegments().size();
+}
+
+size_t AggregateBatcher::addRequests(Ptr<TranslationModel> model, const std::vector<Ptr<Request>> &requests) {
+  size_t numSentences = 0;
+  for (const Ptr<Request> &request : requests) {
+    numSentences += addWholeRequest(model, request);
+  }
+  return numSentences;
+}
+
+bool AggregateBatcher::generateBatch(Ptr<TranslationModel> &model, Batch &batch) {
+  while (!queue_.empty()) {
+    model = queue_.front();
+    queue_.pop_front();
+    if (model->generateBatch(batch)) {
+      // The model may have more sentences queued; give other models a turn
+      // before generating the next batch from it.
+      queue_.push_back(model);
+      return true;
+    }
+  }
+  model = nullptr;
+  batch.clear();
+  return false;
+}
+
+}  // namespace bergamot
+}  // namespace marian
@@ -0,0 +1,49 @@
+#ifndef SRC_BERGAMOT_AGGREGATE_BATCHER_H_
+#define SRC_BERGAMOT_AGGREGATE_BATCHER_H_
+
+#include <deque>
+#include <vector>
+
+#include "batch.h"
+#include "definitions.h"
+#include "request.h"
+
+namespace marian {
+namespace bergamot {
+
+class TranslationModel;
+
+/// Batches across multiple TranslationModels. Each TranslationModel keeps its
+/// own Batcher, as sentences translated by different models cannot be batched
+/// together. AggregateBatcher keeps track of the models that have sentences
+/// queued, and generates batches from them in a round-robin fashion.
+class AggregateBatcher {
+ public:
+  AggregateBatcher() {}
+
+  /// Queues the sentences of request, which was created on model, for
+  /// translation. Returns the number of sentences added.
+  size_t addWholeRequest(Ptr<TranslationModel> model, Ptr<Request> request);
+
+  /// Queues the sentences of all requests, which were created on model, as
+  /// addWholeRequest() does. Returns the number of sentences added.
+  size_t addRequests(Ptr<TranslationModel> model, const std::vector<Ptr<Request>> &requests);
+
+  /// Generates a batch from one of the models that have sentences queued.
+  /// model is set to the model the batch is to be translated with. Returns
+  /// false if no sentences are queued on any model.
+  bool generateBatch(Ptr<TranslationModel> &model, Batch &batch);
+
+  // indicate no more sentences will be added.  Does nothing here, for parity to threadsafe version.
+  void shutdown() {}
+
+ private:
+  /// Models which (possibly) have sentences queued. A model appears at most
+  /// once, and is dropped once it runs out of sentences.
+  std::deque<Ptr<TranslationModel>> queue_;
+};
+
+}  // namespace bergamot
+}  // namespace marian
+
+#endif  // SRC_BERGAMOT_AGGREGATE_BATCHER_H_
@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdlib>
+#include <functional>
 #include <new>
 #ifdef _MSC_VER
 #include <malloc.h>
@@ -26,29 +27,35 @@ public:
 #endif
   }
 
-  AlignedVector(AlignedVector &&from) : mem_(from.mem_), size_(from.size_) {
+  // Wraps memory allocated elsewhere (e.g. mapped shared memory), which the
+  // caller guarantees to be suitably aligned. release is invoked with the
+  // memory on destruction instead of freeing it.
+  AlignedVector(T *mem, std::size_t size, std::function<void(T *, std::size_t)> release)
+          : mem_(mem), size_(size), release_(std::move(release)) {}
+
+  AlignedVector(AlignedVector &&from) : mem_(from.mem_), size_(from.size_), release_(std::move(from.release_)) {
     from.mem_ = nullptr;
     from.size_ = 0;
+    from.release_ = nullptr;
   }
 
   AlignedVector &operator=(AlignedVector &&from) {
-    mem_ = from.mem_;
-    size_ = from.size_;
-    from.mem_ = nullptr;
-    from.size_ = 0;
+    if (this != &from) {
+      deallocate();
+      mem_ = from.mem_;
+      size_ = from.size_;
+      release_ = std::move(from.release_);
+      from.mem_ = nullptr;
+      from.size_ = 0;
+      from.release_ = nullptr;
+    }
     return *this;
   }
 
   AlignedVector(const AlignedVector&) = delete;
   AlignedVector& operator=(const AlignedVector&) = delete;
 
-  ~AlignedVector() {
-#ifdef _MSC_VER
-    _aligned_free(mem_);
-#else
-    std::free(mem_);
-#endif
-  }
+  ~AlignedVector() { deallocate(); }
 
   std::size_t size() const { return size_; }
 
@@ -64,8 +71,21 @@ public:
   ReturnType *as() { return reinterpret_cast<ReturnType*>(mem_); }
 
 private:
+  void deallocate() {
+    if (release_) {
+      release_(mem_, size_);
+      return;
+    }
+#ifdef _MSC_VER
+    _aligned_free(mem_);
+#else
+    std::free(mem_);
+#endif
+  }
+
   T *mem_;
   std::size_t size_;
+  std::function<void(T *, std::size_t)> release_;  // Empty if mem_ is owned.
 };
 } // namespace bergamot
 } // namespace marian
@@ -2,21 +2,34 @@
 
 #include <cassert>
 
+#include "common/logging.h"
+
 namespace marian {
 namespace bergamot {
 
 AnnotatedText::AnnotatedText(std::string &&t) : text(std::move(t)) {
+  ABORT_IF(text.size() > Annotation::kMaxSize, "Text of {} bytes is too large to annotate", text.size());
   // Treat the entire text as a gap that recordExistingSentence will break.
   annotation.token_begin_.back() = text.size();
 }
 
+AnnotatedText::AnnotatedText(string_view borrowed, std::shared_ptr<const void> lifetime)
+    : borrowed_(true), borrowedText_(borrowed), lifetime_(std::move(lifetime)) {
+  ABORT_IF(borrowedText_.size() > Annotation::kMaxSize, "Text of {} bytes is too large to annotate",
+           borrowedText_.size());
+  annotation.token_begin_.back() = borrowedText_.size();
+}
+
 void AnnotatedText::appendSentence(string_view prefix, std::vector<string_view>::iterator begin,
                                    std::vector<string_view>::iterator end) {
+  assert(!borrowed_);
   assert(annotation.token_begin_.back() == text.size());
 
   // prefix is just end of the previous one.
   appendEndingWhitespace(prefix);
 
+  annotation.reserveSentence(end - begin);
+
   // Appending sentence text.
   std::size_t offset = text.size();
   for (std::vector<string_view>::iterator token = begin; token != end; ++token) {
@@ -26,6 +39,7 @@ void AnnotatedText::appendSentence(string_view prefix, std::vector<string_view>:
   if (begin != end) {
     text.append(begin->data(), (end - 1)->data() + (end - 1)->size());
     assert(offset == text.size());  // Tokens should be contiguous.
+    ABORT_IF(text.size() > Annotation::kMaxSize, "Text is too large to annotate");
   }
 
   // Add the gap after the sentence.  This is empty for now, but will be
@@ -35,35 +49,54 @@ void AnnotatedText::appendSentence(string_view prefix, std::vector<string_view>:
 }
 
 void AnnotatedText::appendEndingWhitespace(string_view whitespace) {
+  assert(!borrowed_);
+  ABORT_IF(text.size() + whitespace.size() > Annotation::kMaxSize, "Text is too large to annotate");
   text.append(whitespace.data(), whitespace.size());
   annotation.token_begin_.back() = text.size();
 }
 
 void AnnotatedText::recordExistingSentence(std::vector<string_view>::iterator begin,
                                            std::vector<string_view>::iterator end, const char *sentence_begin) {
-  assert(sentence_begin >= text.data());
-  assert(sentence_begin <= text.data() + text.size());
+  string_view buffer = view();
+  assert(sentence_begin >= buffer.data());
+  assert(sentence_begin <= buffer.data() + buffer.size());
   assert(begin == end || sentence_begin == begin->data());
   assert(!annotation.token_begin_.empty());
-  assert(annotation.token_begin_.back() == text.size());
+  assert(annotation.token_begin_.back() == buffer.size());
+  annotation.reserveSentence(end - begin);
   // Clip off size token ending.
   annotation.token_begin_.resize(annotation.token_begin_.size() - 1);
   for (std::vector<string_view>::iterator i = begin; i != end; ++i) {
-    assert(i->data() >= text.data());                                  // In range.
-    assert(i->data() + i->size() <= text.data() + text.size());        // In range
+    assert(i->data() >= buffer.data());                                // In range.
+    assert(i->data() + i->size() <= buffer.data() + buffer.size());    // In range
     assert(i + 1 == end || i->data() + i->size() == (i + 1)->data());  // Contiguous
-    annotation.token_begin_.push_back(i->data() - text.data());
+    annotation.token_begin_.push_back(i->data() - buffer.data());
   }
   // Gap token after sentence.
   annotation.gap_.push_back(annotation.token_begin_.size());
   if (begin != end) {
-    annotation.token_begin_.push_back((end - 1)->data() + (end - 1)->size() - text.data());
+    annotation.token_begin_.push_back((end - 1)->data() + (end - 1)->size() - buffer.data());
   } else {
     // empty sentence.
-    annotation.token_begin_.push_back(sentence_begin - text.data());
+    annotation.token_begin_.push_back(sentence_begin - buffer.data());
   }
   // Add back size token ending.
-  annotation.token_begin_.push_back(text.size());
+  annotation.token_begin_.push_back(buffer.size());
+}
+
+AnnotatedText AnnotatedText::extractSentence(size_t sentenceIdx) const {
+  string_view sentenceView = sentence(sentenceIdx);
+  AnnotatedText extracted(std::string(sentenceView.data(), sentenceView.size()));
+
+  // Rebase the words onto the copied text.
+  std::vector<string_view> words;
+  words.reserve(numWords(sentenceIdx));
+  for (size_t wordIdx = 0; wordIdx < numWords(sentenceIdx); wordIdx++) {
+    string_view wordView = word(sentenceIdx, wordIdx);
+    words.emplace_back(extracted.text.data() + (wordView.data() - sentenceView.data()), wordView.size());
+  }
+  extracted.recordExistingSentence(words.begin(), words.end(), extracted.text.data());
+  return extracted;
 }
 
 }  // namespace bergamot
@@ -1,7 +1,12 @@
 #ifndef BERGAMOT_SENTENCE_RANGES_H_
 #define BERGAMOT_SENTENCE_RANGES_H_
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -42,8 +47,18 @@ struct ByteRange {
 /// beginning).  A sentence can also be empty (typically the translation system
 /// produced empty output).  That's fine, these are just empty ranges as you
 /// would expect.
+///
+/// Offsets and token indices are stored in 32 bits, half of what size_t takes,
+/// as there are two of them per token in both source and target of every
+/// Response. Texts are therefore limited to kMaxSize bytes.
 class Annotation {
  public:
+  /// Type byte offsets and token indices are stored as.
+  typedef uint32_t Offset;
+
+  /// Largest text (in bytes) that can be annotated.
+  static constexpr size_t kMaxSize = std::numeric_limits<Offset>::max();
+
   /// Initially an empty string.  Populated by AnnotatedText.
   Annotation() {
     token_begin_.push_back(0);
@@ -81,13 +96,31 @@ class Annotation {
     return ByteRange{token_begin_[tokenIdx], token_begin_[tokenIdx + 1]};
   }
 
+  /// Reserves room for this many more sentences, of this many more words in
+  /// total, so that recording them does not reallocate.
+  void reserve(size_t sentences, size_t words) {
+    token_begin_.reserve(token_begin_.size() + sentences + words);
+    gap_.reserve(gap_.size() + sentences);
+  }
+
  private:
   friend class AnnotatedText;
+
+  /// Makes room for a sentence of this many words. Grows geometrically, so
+  /// that recording sentences one by one stays amortized linear, but at once
+  /// for the whole sentence.
+  void reserveSentence(size_t words) {
+    size_t needed = token_begin_.size() + words + 1;
+    if (needed > token_begin_.capacity()) {
+      token_begin_.reserve(std::max(needed, 2 * token_begin_.capacity()));
+    }
+  }
+
   /// Map from token index to byte offset at which it begins.  Token i is:
   ///   [token_begin_[i], token_begin_[i+1])
   /// The vector is padded so that these indices are always valid, even at the
   /// end.  So tokens_begin_.size() is the number of tokens plus 1.
-  std::vector<size_t> token_begin_;
+  std::vector<Offset> token_begin_;
 
   /// Indices of tokens that correspond to gaps between sentences.  These are
   /// indices into token_begin_.
@@ -110,7 +143,7 @@ class Annotation {
   /// Example: one token "hi" -> empty gap, sentence with one token, empty gap
   /// token_begin_ = {0, 0, 2, 2};
   /// gap_ = {0, 2};
-  std::vector<size_t> gap_;
+  std::vector<Offset> gap_;
 };
 
 /// AnnotatedText is effectively std::string text + Annotation, providing the
@@ -126,7 +159,7 @@ class Annotation {
 /// unit.
 struct AnnotatedText {
  public:
-  std::string text;       ///< Blob of string elements in annotation refers to.
+  std::string text;       ///< Blob of string elements in annotation refers to. Empty if borrowed.
   Annotation annotation;  ///< sentence and (sub-) word annotations.
 
   /// Construct an empty AnnotatedText. This is useful when the target string or
@@ -140,6 +173,19 @@ struct AnnotatedText {
   /// constructor is disallowed).
   AnnotatedText(std::string &&text);
 
+  /// Construct referencing text owned by the caller instead of a copy, for
+  /// large inputs already in memory (e.g. an mmapped file or network buffer).
+  /// The buffer must remain valid and unmodified while lifetime is held;
+  /// AnnotatedText (and copies of it) hold on to lifetime. Such an
+  /// AnnotatedText can only record existing sentences, not append new ones.
+  AnnotatedText(string_view borrowed, std::shared_ptr<const void> lifetime);
+
+  /// Returns the text annotations refer to: text, or the borrowed buffer.
+  string_view view() const { return borrowed_ ? borrowedText_ : string_view(text); }
+
+  /// Whether the text is borrowed from the caller rather than held in text.
+  bool isBorrowed() const { return borrowed_; }
+
   /// Appends a sentence to the existing text and transparently rebases
   /// string_views.  Since this tracks only prefix, remember
   /// appendEndingWhitespace.
@@ -160,6 +206,14 @@ struct AnnotatedText {
   void recordExistingSentence(std::vector<string_view>::iterator tokens_begin,
                               std::vector<string_view>::iterator tokens_end, const char *sentence_begin);
 
+  /// Reserves room for this many more sentences, of this many more words in
+  /// total, when known up front. Optional.
+  void reserve(size_t sentences, size_t words) { annotation.reserve(sentences, words); }
+
+  /// Returns the sentence corresponding to sentenceIdx and its words as an
+  /// AnnotatedText of its own, without the surrounding gaps.
+  AnnotatedText extractSentence(size_t sentenceIdx) const;
+
   /// Returns the number of sentences in the annotation structure.
   const size_t numSentences() const { return annotation.numSentences(); }
 
@@ -194,8 +248,12 @@ struct AnnotatedText {
 
  private:
   string_view asStringView(const ByteRange &byteRange) const {
-    return string_view(text.data() + byteRange.begin, byteRange.size());
+    return string_view(view().data() + byteRange.begin, byteRange.size());
   }
+
+  bool borrowed_{false};
+  string_view borrowedText_;
+  std::shared_ptr<const void> lifetime_;
 };
 
 }  // namespace bergamot
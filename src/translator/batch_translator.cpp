@@ -1,7 +1,6 @@
 #include "batch_translator.h"
 
 #include "batch.h"
-#include "byte_array_util.h"
 #include "common/logging.h"
 #include "data/corpus.h"
 #include "data/text_input.h"
@@ -11,34 +10,16 @@ namespace marian {
 namespace bergamot {
 
 BatchTranslator::BatchTranslator(DeviceId const device, Vocabs &vocabs, Ptr<Options> options,
-                                 const AlignedMemory *modelMemory, const AlignedMemory *shortlistMemory)
+                                 const AlignedMemory *modelMemory,
+                                 Ptr<data::ShortlistGenerator const> shortlistGenerator)
     : device_(device),
       options_(options),
       vocabs_(vocabs),
       modelMemory_(modelMemory),
-      shortlistMemory_(shortlistMemory) {}
+      slgen_(shortlistGenerator) {}
 
 void BatchTranslator::initialize() {
   // Initializes the graph.
-  bool check =
-      options_->get<bool>("check-bytearray", false);  // Flag holds whether validate the bytearray (model and shortlist)
-  if (options_->hasAndNotEmpty("shortlist")) {
-    int srcIdx = 0, trgIdx = 1;
-    bool shared_vcb =
-        vocabs_.sources().front() ==
-        vocabs_.target();  // vocabs_->sources().front() is invoked as we currently only support one source vocab
-    if (shortlistMemory_->size() > 0 && shortlistMemory_->begin() != nullptr) {
-      slgen_ = New<data::BinaryShortlistGenerator>(shortlistMemory_->begin(), shortlistMemory_->size(),
-                                                   vocabs_.sources().front(), vocabs_.target(), srcIdx, trgIdx,
-                                                   shared_vcb, check);
-    } else {
-      // Changed to BinaryShortlistGenerator to enable loading binary shortlist file
-      // This class also supports text shortlist file
-      slgen_ = New<data::BinaryShortlistGenerator>(options_, vocabs_.sources().front(), vocabs_.target(), srcIdx,
-                                                   trgIdx, shared_vcb);
-    }
-  }
-
   graph_ = New<ExpressionGraph>(true);  // set the graph to be inference only
   auto prec = options_->get<std::vector<std::string>>("precision", {"float32"});
   graph_->setDefaultElementType(typeFromString(prec[0]));
@@ -49,12 +30,10 @@ void BatchTranslator::initialize() {
       modelMemory_->begin() !=
           nullptr) {  // If we have provided a byte array that contains the model memory, we can initialise the model
                       // from there, as opposed to from reading in the config file
+    // The contents of modelMemory_ are validated (check-bytearray) once in
+    // Service rather than in every worker.
     ABORT_IF((uintptr_t)modelMemory_->begin() % 256 != 0,
              "The provided memory is not aligned to 256 bytes and will crash when vector instructions are used on it.");
-    if (check) {
-      ABORT_IF(!validateBinaryModel(*modelMemory_, modelMemory_->size()),
-               "The binary file is invalid. Incomplete or corrupted download?");
-    }
     const std::vector<const void *> container = {
         modelMemory_->begin()};  // Marian supports multiple models initialised in this manner hence std::vector.
                                  // However we will only ever use 1 during decoding.
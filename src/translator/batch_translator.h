@@ -30,10 +30,11 @@ class BatchTranslator {
    * @param options Marian options object
    * @param modelMemory byte array (aligned to 256!!!) that contains the bytes of a model.bin. Provide a nullptr if not
    * used.
-   * @param shortlistMemory byte array of shortlist (aligned to 64)
+   * @param shortlistGenerator shortlist generator shared (read-only) among all workers. Provide a nullptr if no
+   * shortlist is used.
    */
   explicit BatchTranslator(DeviceId const device, Vocabs& vocabs, Ptr<Options> options,
-                           const AlignedMemory* modelMemory, const AlignedMemory* shortlistMemory);
+                           const AlignedMemory* modelMemory, Ptr<data::ShortlistGenerator const> shortlistGenerator);
 
   // convenience function for logging. TODO(jerin)
   std::string _identifier() { return "worker" + std::to_string(device_.no); }
@@ -48,7 +49,6 @@ class BatchTranslator {
   std::vector<Ptr<Scorer>> scorers_;
   Ptr<data::ShortlistGenerator const> slgen_;
   const AlignedMemory* modelMemory_{nullptr};
-  const AlignedMemory* shortlistMemory_{nullptr};
 };
 
 }  // namespace bergamot
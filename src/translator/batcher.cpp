@@ -51,7 +51,7 @@ bool Batcher::cleaveBatch(Batch &batch) {
 }
 
 void Batcher::addWholeRequest(Ptr<Request> request) {
-  for (size_t i = 0; i < request->numSegments(); i++) {
+  for (size_t i : request->pendingSegments()) {
     RequestSentence requestSentence(i, request);
     addSentenceWithPriority(requestSentence);
   }
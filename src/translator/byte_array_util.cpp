@@ -2,8 +2,26 @@
 
 #include <stdlib.h>
 
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <memory>
+#ifndef WASM_COMPATIBLE_SOURCE
+#include <thread>
+#endif
+
+#if !defined(_WIN32) && !defined(WASM_COMPATIBLE_SOURCE)
+#define BERGAMOT_SHARED_MEMORY
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#endif
 
 namespace marian {
 namespace bergamot {
@@ -28,6 +46,169 @@ const T* get(const void*& current, uint64_t num = 1) {
   current = (const T*)current + num;
   return ptr;
 }
+
+// xxHash64 (https://github.com/Cyan4973/xxHash), reimplemented here to avoid
+// an additional dependency. Reads are little-endian.
+const uint64_t kPrime1 = 11400714785074694791ULL;
+const uint64_t kPrime2 = 14029467366897019727ULL;
+const uint64_t kPrime3 = 1609587929392839161ULL;
+const uint64_t kPrime4 = 9650029242287828579ULL;
+const uint64_t kPrime5 = 2870177450012600261ULL;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t read64(const char* p) {
+  uint64_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline uint32_t read32(const char* p) {
+  uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+inline uint64_t round(uint64_t acc, uint64_t input) {
+  acc += input * kPrime2;
+  acc = rotl(acc, 31);
+  return acc * kPrime1;
+}
+
+inline uint64_t mergeRound(uint64_t acc, uint64_t value) {
+  acc ^= round(0, value);
+  return acc * kPrime1 + kPrime4;
+}
+
+uint64_t xxHash64(const char* data, size_t size, uint64_t seed = 0) {
+  const char* p = data;
+  const char* end = data + size;
+  uint64_t h64;
+
+  if (size >= 32) {
+    uint64_t v1 = seed + kPrime1 + kPrime2;
+    uint64_t v2 = seed + kPrime2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - kPrime1;
+    for (; p + 32 <= end; p += 32) {
+      v1 = round(v1, read64(p));
+      v2 = round(v2, read64(p + 8));
+      v3 = round(v3, read64(p + 16));
+      v4 = round(v4, read64(p + 24));
+    }
+    h64 = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+    h64 = mergeRound(h64, v1);
+    h64 = mergeRound(h64, v2);
+    h64 = mergeRound(h64, v3);
+    h64 = mergeRound(h64, v4);
+  } else {
+    h64 = seed + kPrime5;
+  }
+
+  h64 += static_cast<uint64_t>(size);
+
+  for (; p + 8 <= end; p += 8) {
+    h64 ^= round(0, read64(p));
+    h64 = rotl(h64, 27) * kPrime1 + kPrime4;
+  }
+  if (p + 4 <= end) {
+    h64 ^= static_cast<uint64_t>(read32(p)) * kPrime1;
+    h64 = rotl(h64, 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    h64 ^= static_cast<uint64_t>(static_cast<unsigned char>(*p)) * kPrime5;
+    h64 = rotl(h64, 11) * kPrime1;
+  }
+
+  // Avalanche
+  h64 ^= h64 >> 33;
+  h64 *= kPrime2;
+  h64 ^= h64 >> 29;
+  h64 *= kPrime3;
+  h64 ^= h64 >> 32;
+  return h64;
+}
+
+// Size of the chunks hashed independently by computeChecksum. Part of the
+// checksum definition, changing this changes the checksum of every file.
+const size_t kChecksumChunkSize = 1 << 20;
+
+// POSIX shared memory object names start with a slash and contain no other.
+std::string sharedMemoryName(const std::string& name, const std::string& suffix) { return "/" + name + "." + suffix; }
+
+#ifdef BERGAMOT_SHARED_MEMORY
+// A shared memory segment starts with a header, padded so that the contents
+// which follow are aligned to 256 bytes (segments are mapped page-aligned).
+struct SharedMemoryHeader {
+  std::atomic<uint64_t> state;  // kSharedMemoryReady once contents are written.
+  uint64_t size;                // Size of the contents.
+  uint64_t fileModified;        // Modification time of the file loaded, in seconds.
+  uint64_t fileInode;           // Inode of the file loaded.
+};
+const size_t kSharedMemoryHeaderSize = 256;
+const uint64_t kSharedMemoryReady = 0x79646165724d5442ULL;  // "BTMready"
+
+// How long to wait for another process to finish loading a segment.
+const auto kSharedMemoryTimeout = std::chrono::seconds(120);
+
+// What identifies the version of a file: a segment is only used if it was
+// loaded from a file of the same size, modification time and inode.
+struct FileIdentity {
+  uint64_t size;
+  uint64_t modified;
+  uint64_t inode;
+};
+
+FileIdentity identifyFile(const std::string& path) {
+  struct stat st;
+  ABORT_IF(stat(path.c_str(), &st) == -1, "Failed to stat {}: {}", path, strerror(errno));
+  return FileIdentity{static_cast<uint64_t>(st.st_size), static_cast<uint64_t>(st.st_mtime),
+                      static_cast<uint64_t>(st.st_ino)};
+}
+
+// Wraps the contents of a mapped segment beginning at base as AlignedMemory,
+// which unmaps the segment when released.
+AlignedMemory wrapSharedMemory(char* base, uint64_t size) {
+  return AlignedMemory(base + kSharedMemoryHeaderSize, size, [](char* contents, size_t size) {
+    munmap(contents - kSharedMemoryHeaderSize, size + kSharedMemoryHeaderSize);
+  });
+}
+
+// Maps an existing segment read-only, waiting for the process which created it
+// to finish writing its contents. Aborts if the segment was loaded from another
+// version of the file at path than the one there now.
+AlignedMemory attachSharedMemory(const std::string& name, const std::string& path) {
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  ABORT_IF(fd == -1, "Failed to open shared memory {}: {}", name, strerror(errno));
+
+  auto deadline = std::chrono::steady_clock::now() + kSharedMemoryTimeout;
+  while (true) {
+    struct stat st;
+    ABORT_IF(fstat(fd, &st) == -1, "Failed to stat shared memory {}: {}", name, strerror(errno));
+    if (static_cast<size_t>(st.st_size) >= kSharedMemoryHeaderSize) {
+      void* base = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      ABORT_IF(base == MAP_FAILED, "Failed to map shared memory {}: {}", name, strerror(errno));
+      const SharedMemoryHeader* header = reinterpret_cast<const SharedMemoryHeader*>(base);
+      if (header->state.load(std::memory_order_acquire) == kSharedMemoryReady) {
+        ABORT_IF(header->size + kSharedMemoryHeaderSize != static_cast<uint64_t>(st.st_size),
+                 "Shared memory {} is inconsistent with its header.", name);
+        FileIdentity file = identifyFile(path);
+        ABORT_IF(header->size != file.size || header->fileModified != file.modified || header->fileInode != file.inode,
+                 "Shared memory {} holds another version of {} than the one on disk. Remove it once no process "
+                 "uses it (see unlinkSharedMemoryBundle), or use another --bytearray-shared-memory name.",
+                 name, path);
+        close(fd);
+        return wrapSharedMemory(reinterpret_cast<char*>(base), header->size);
+      }
+      munmap(base, st.st_size);
+    }
+    ABORT_IF(std::chrono::steady_clock::now() > deadline,
+             "Timed out waiting for shared memory {} to be loaded. Remove it if the loading process died.", name);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+}
+#endif  // BERGAMOT_SHARED_MEMORY
 }  // Anonymous namespace
 
 bool validateBinaryModel(const AlignedMemory& model, uint64_t fileSize) {
@@ -80,6 +261,55 @@ bool validateBinaryModel(const AlignedMemory& model, uint64_t fileSize) {
   }
 }
 
+uint64_t computeChecksum(const AlignedMemory& memory, size_t numThreads) {
+  size_t numChunks = (memory.size() + kChecksumChunkSize - 1) / kChecksumChunkSize;
+  std::vector<uint64_t> chunkHashes(numChunks);
+
+  // Worker threadId hashes chunks threadId, threadId + numThreads, ...
+  auto hashChunks = [&memory, &chunkHashes, numChunks](size_t threadId, size_t numThreads) {
+    for (size_t chunk = threadId; chunk < numChunks; chunk += numThreads) {
+      size_t offset = chunk * kChecksumChunkSize;
+      size_t size = std::min(kChecksumChunkSize, memory.size() - offset);
+      chunkHashes[chunk] = xxHash64(memory.begin() + offset, size);
+    }
+  };
+
+#ifdef WASM_COMPATIBLE_SOURCE
+  hashChunks(/*threadId=*/0, /*numThreads=*/1);
+#else
+  numThreads = std::max<size_t>(1, std::min(numThreads, numChunks));
+  std::vector<std::thread> threads;
+  threads.reserve(numThreads - 1);
+  for (size_t threadId = 1; threadId < numThreads; threadId++) {
+    threads.emplace_back(hashChunks, threadId, numThreads);
+  }
+  hashChunks(/*threadId=*/0, numThreads);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+#endif
+
+  return xxHash64(reinterpret_cast<const char*>(chunkHashes.data()), chunkHashes.size() * sizeof(uint64_t));
+}
+
+bool parseChecksum(const std::string& text, uint64_t& checksum) {
+  if (text.size() != 2 * sizeof(uint64_t)) {
+    return false;
+  }
+  for (char c : text) {
+    if (!std::isxdigit(static_cast<unsigned char>(c))) {
+      return false;
+    }
+  }
+  char* end = nullptr;
+  uint64_t value = std::strtoull(text.c_str(), &end, 16);
+  if (end != text.c_str() + text.size()) {
+    return false;
+  }
+  checksum = value;
+  return true;
+}
+
 AlignedMemory loadFileToMemory(const std::string& path, size_t alignment) {
   uint64_t fileSize = filesystem::fileSize(path);
   io::InputFileStream in(path);
@@ -90,6 +320,51 @@ AlignedMemory loadFileToMemory(const std::string& path, size_t alignment) {
   return alignedMemory;
 }
 
+AlignedMemory loadFileToSharedMemory(const std::string& path, const std::string& name) {
+#ifdef BERGAMOT_SHARED_MEMORY
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd == -1 && errno == EEXIST) {
+    // Created by another process.
+    return attachSharedMemory(name, path);
+  }
+  ABORT_IF(fd == -1, "Failed to create shared memory {}: {}", name, strerror(errno));
+
+  FileIdentity file = identifyFile(path);
+  uint64_t fileSize = file.size;
+  size_t totalSize = kSharedMemoryHeaderSize + fileSize;
+  ABORT_IF(ftruncate(fd, totalSize) == -1, "Failed to resize shared memory {}: {}", name, strerror(errno));
+  void* base = mmap(nullptr, totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  ABORT_IF(base == MAP_FAILED, "Failed to map shared memory {}: {}", name, strerror(errno));
+
+  io::InputFileStream in(path);
+  ABORT_IF(in.bad(), "Failed opening file stream: {}", path);
+  char* contents = reinterpret_cast<char*>(base) + kSharedMemoryHeaderSize;
+  in.read(contents, fileSize);
+  if (!in || static_cast<uint64_t>(in.gcount()) != fileSize) {
+    // Not published, so that no process uses the partial contents. Processes
+    // waiting for them time out.
+    munmap(base, totalSize);
+    shm_unlink(name.c_str());
+    ABORT("Failed reading {} into shared memory {}", path, name);
+  }
+
+  // Publish the contents to other processes waiting in attachSharedMemory.
+  SharedMemoryHeader* header = new (base) SharedMemoryHeader();
+  header->size = fileSize;
+  header->fileModified = file.modified;
+  header->fileInode = file.inode;
+  header->state.store(kSharedMemoryReady, std::memory_order_release);
+
+  // From here on, this process uses the segment read-only as well.
+  ABORT_IF(mprotect(base, totalSize, PROT_READ) == -1, "Failed to protect shared memory {}: {}", name,
+           strerror(errno));
+  return wrapSharedMemory(reinterpret_cast<char*>(base), fileSize);
+#else
+  ABORT("Shared memory is not supported on this platform.");
+#endif
+}
+
 AlignedMemory getModelMemoryFromConfig(marian::Ptr<marian::Options> options) {
   auto models = options->get<std::vector<std::string>>("models");
   ABORT_IF(models.size() != 1, "Loading multiple binary models is not supported for now as it is not necessary.");
@@ -128,5 +403,29 @@ MemoryBundle getMemoryBundleFromConfig(marian::Ptr<marian::Options> options) {
   return memoryBundle;
 }
 
+MemoryBundle getMemoryBundleFromSharedMemory(marian::Ptr<marian::Options> options, const std::string& name) {
+  auto models = options->get<std::vector<std::string>>("models");
+  ABORT_IF(models.size() != 1, "Loading multiple binary models is not supported for now as it is not necessary.");
+
+  MemoryBundle memoryBundle;
+  memoryBundle.model = loadFileToSharedMemory(models[0], sharedMemoryName(name, "model"));
+  // The shortlist is optional, as for loading from files.
+  if (options->hasAndNotEmpty("shortlist")) {
+    auto shortlist = options->get<std::vector<std::string>>("shortlist");
+    memoryBundle.shortlist = loadFileToSharedMemory(shortlist[0], sharedMemoryName(name, "shortlist"));
+  }
+  // Vocabs are parsed into process-local structures on load anyway, so sharing
+  // their bytes would not save memory.
+  getVocabsMemoryFromConfig(options, memoryBundle.vocabs);
+  return memoryBundle;
+}
+
+void unlinkSharedMemoryBundle(const std::string& name) {
+#ifdef BERGAMOT_SHARED_MEMORY
+  shm_unlink(sharedMemoryName(name, "model").c_str());
+  shm_unlink(sharedMemoryName(name, "shortlist").c_str());
+#endif
+}
+
 }  // namespace bergamot
 }  // namespace marian
@@ -10,6 +10,34 @@ AlignedMemory getShortlistMemoryFromConfig(marian::Ptr<marian::Options> options)
 void getVocabsMemoryFromConfig(marian::Ptr<marian::Options> options,
                                std::vector<std::shared_ptr<AlignedMemory>>& vocabMemories);
 bool validateBinaryModel(const AlignedMemory& model, uint64_t fileSize);
+
+/// Computes a checksum of the contents of memory. The memory is hashed with xxHash64 in fixed-size chunks, and the
+/// hashes of the chunks are then hashed together. The result does not depend on numThreads, which only sets how many
+/// chunks are hashed in parallel.
+uint64_t computeChecksum(const AlignedMemory& memory, size_t numThreads = 1);
+
+/// Parses a checksum as computeChecksum's result is logged and given to --model-checksum: exactly 16 hexadecimal
+/// digits. Returns false, leaving checksum unchanged, if text is not such.
+bool parseChecksum(const std::string& text, uint64_t& checksum);
 MemoryBundle getMemoryBundleFromConfig(marian::Ptr<marian::Options> options);
+
+/// Maps a named (POSIX) shared memory segment holding the contents of the file at path, read-only. The first process
+/// to ask for the segment creates it and loads the file into it; other processes attach to the existing segment, so
+/// the contents are resident in memory only once across processes. The memory is aligned to 256 bytes. Not available
+/// on Windows or WASM.
+///
+/// The segment records the size, modification time and inode of the file it was loaded from, and attaching aborts if
+/// the file at path no longer matches, rather than using stale contents. Segments outlive the processes using them:
+/// they stay until removed with unlinkSharedMemoryBundle (e.g. service-cli --unlink-shared-memory) or the machine
+/// restarts. Whoever manages the model's deployment is to remove them once the model is no longer needed or replaced.
+AlignedMemory loadFileToSharedMemory(const std::string& path, const std::string& name);
+
+/// Loads model and shortlist, if given, into shared memory segments (see loadFileToSharedMemory) named after name, and
+/// vocabs into process-local memory.
+MemoryBundle getMemoryBundleFromSharedMemory(marian::Ptr<marian::Options> options, const std::string& name);
+
+/// Removes the shared memory segments created by getMemoryBundleFromSharedMemory. Processes that have them mapped keep
+/// access until their AlignedMemory is released.
+void unlinkSharedMemoryBundle(const std::string& name);
 }  // namespace bergamot
 }  // namespace marian
@@ -0,0 +1,75 @@
+#include "completion_executor.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace marian {
+namespace bergamot {
+
+#ifdef WASM_COMPATIBLE_SOURCE
+
+CompletionExecutor::CompletionExecutor(size_t /*numThreads*/) {}
+
+CompletionExecutor::~CompletionExecutor() {}
+
+void CompletionExecutor::submit(Task &&task) { task(); }
+
+void CompletionExecutor::drain() {}
+
+#else
+
+CompletionExecutor::CompletionExecutor(size_t numThreads) {
+  numThreads = std::max<size_t>(1, numThreads);
+  threads_.reserve(numThreads);
+  for (size_t threadIdx = 0; threadIdx < numThreads; threadIdx++) {
+    threads_.emplace_back([this]() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (true) {
+        work_.wait(lock, [this]() { return shutdown_ || !tasks_.empty(); });
+        // Queued tasks complete Requests whose clients wait on them, so they
+        // are run even when shutting down.
+        if (tasks_.empty()) {
+          return;
+        }
+        Task task = std::move(tasks_.front());
+        tasks_.pop_front();
+        running_++;
+        lock.unlock();
+        task();
+        lock.lock();
+        if (--running_ == 0 && tasks_.empty()) {
+          drained_.notify_all();
+        }
+      }
+    });
+  }
+}
+
+CompletionExecutor::~CompletionExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  work_.notify_all();
+  for (std::thread &thread : threads_) {
+    thread.join();
+  }
+}
+
+void CompletionExecutor::submit(Task &&task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  work_.notify_one();
+}
+
+void CompletionExecutor::drain() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  drained_.wait(lock, [this]() { return tasks_.empty() && running_ == 0; });
+}
+
+#endif
+
+}  // namespace bergamot
+}  // namespace marian
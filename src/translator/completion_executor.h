@@ -0,0 +1,58 @@
+#ifndef SRC_BERGAMOT_COMPLETION_EXECUTOR_H_
+#define SRC_BERGAMOT_COMPLETION_EXECUTOR_H_
+
+#include <cstddef>
+#include <functional>
+
+#ifndef WASM_COMPATIBLE_SOURCE
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif
+
+namespace marian {
+namespace bergamot {
+
+/// CompletionExecutor runs the completion of Requests (building the Response
+/// from its histories and calling back) on threads of its own, so that the
+/// worker translating the last sentence of a Request can go on to the next
+/// batch instead of detokenizing, converting alignments and concatenating
+/// text. See --completion-threads.
+///
+/// Without threads (WASM), tasks run right away on the submitting thread.
+class CompletionExecutor {
+ public:
+  typedef std::function<void()> Task;
+
+  /// Starts numThreads threads, at least one.
+  explicit CompletionExecutor(size_t numThreads);
+
+  /// Runs the tasks still queued, then stops the threads.
+  ~CompletionExecutor();
+
+  /// Queues task to run on one of the threads. Tasks may run concurrently and
+  /// in any order.
+  void submit(Task &&task);
+
+  /// Blocks until no task is queued or running, including tasks submitted
+  /// meanwhile.
+  void drain();
+
+#ifndef WASM_COMPATIBLE_SOURCE
+ private:
+  std::vector<std::thread> threads_;
+  std::deque<Task> tasks_;
+  size_t running_{0};
+  bool shutdown_{false};
+  std::mutex mutex_;
+  std::condition_variable work_;
+  std::condition_variable drained_;
+#endif
+};
+
+}  // namespace bergamot
+}  // namespace marian
+
+#endif  // SRC_BERGAMOT_COMPLETION_EXECUTOR_H_
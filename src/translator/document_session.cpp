@@ -0,0 +1,83 @@
+#include "document_session.h"
+
+#include <utility>
+
+namespace marian {
+namespace bergamot {
+
+size_t DocumentSession::size() const {
+#ifndef WASM_COMPATIBLE_SOURCE
+  std::lock_guard<std::mutex> lock(state_->mutex);
+#endif
+  return state_->histories.size();
+}
+
+void DocumentSession::clear() {
+#ifndef WASM_COMPATIBLE_SOURCE
+  std::lock_guard<std::mutex> lock(state_->mutex);
+#endif
+  state_->histories.clear();
+  // Revisions queued before clear() must not bring their translations back.
+  state_->completedRevision = state_->revisions;
+}
+
+void DocumentSession::bind(std::shared_ptr<TranslationModel> model) {
+#ifndef WASM_COMPATIBLE_SOURCE
+  std::lock_guard<std::mutex> lock(state_->mutex);
+#endif
+  if (state_->model.lock() != model) {
+    state_->histories.clear();
+    state_->completedRevision = state_->revisions;
+    state_->model = model;
+  }
+}
+
+Histories DocumentSession::lookup(const AnnotatedText &source, std::function<void(const Histories &)> &onComplete) {
+  std::vector<std::string> sentences;
+  sentences.reserve(source.numSentences());
+  for (size_t sentenceIdx = 0; sentenceIdx < source.numSentences(); sentenceIdx++) {
+    string_view sentence = source.sentence(sentenceIdx);
+    sentences.emplace_back(sentence.data(), sentence.size());
+  }
+
+  Histories histories(sentences.size(), nullptr);
+  size_t revision;
+  {
+#ifndef WASM_COMPATIBLE_SOURCE
+    std::lock_guard<std::mutex> lock(state_->mutex);
+#endif
+    for (size_t sentenceIdx = 0; sentenceIdx < sentences.size(); sentenceIdx++) {
+      auto kept = state_->histories.find(sentences[sentenceIdx]);
+      if (kept != state_->histories.end()) {
+        histories[sentenceIdx] = kept->second;
+      }
+    }
+    revision = ++state_->revisions;
+  }
+
+  // Called by the worker completing the revision. Sentences of the previous
+  // revision that are not in this one are dropped, so the session does not
+  // grow with the edit history.
+  std::shared_ptr<State> state = state_;
+  onComplete = [state, revision, sentences = std::move(sentences)](const Histories &histories) {
+#ifndef WASM_COMPATIBLE_SOURCE
+    std::lock_guard<std::mutex> lock(state->mutex);
+#endif
+    if (revision <= state->completedRevision) {
+      return;
+    }
+    state->completedRevision = revision;
+    state->histories.clear();
+    for (size_t sentenceIdx = 0; sentenceIdx < sentences.size(); sentenceIdx++) {
+      // Sentences passed through have no history, and are cheap to classify
+      // again.
+      if (histories[sentenceIdx] != nullptr) {
+        state->histories.emplace(sentences[sentenceIdx], histories[sentenceIdx]);
+      }
+    }
+  };
+  return histories;
+}
+
+}  // namespace bergamot
+}  // namespace marian
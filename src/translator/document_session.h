@@ -0,0 +1,81 @@
+#ifndef SRC_BERGAMOT_DOCUMENT_SESSION_H_
+#define SRC_BERGAMOT_DOCUMENT_SESSION_H_
+
+#include <functional>
+#include <memory>
+#ifndef WASM_COMPATIBLE_SOURCE
+#include <mutex>
+#endif
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "annotation.h"
+#include "data/types.h"
+#include "translator/history.h"
+
+namespace marian {
+namespace bergamot {
+
+class TranslationModel;
+
+/// DocumentSession keeps the translations of the sentences of the latest
+/// revision of a document, for documents that are re-sent in whole after every
+/// edit. Translating a revision through Service::translate(DocumentSession &,
+/// ...) splits and tokenizes it as usual, but only decodes the sentences whose
+/// text is not found in the previous revision. The Response is built from the
+/// kept translations of unchanged sentences and the new ones, including
+/// alignments and quality scores if requested.
+///
+/// Sentences are matched by their text, so unchanged sentences are reused
+/// wherever they moved. Kept translations are dropped when the Service's model
+/// changes (see Service::reload).
+///
+/// A revision may be queued before the previous one completes. The translations
+/// kept are always those of the latest revision completed.
+class DocumentSession {
+ public:
+  DocumentSession() : state_(std::make_shared<State>()) {}
+
+  /// Number of sentences with a translation kept.
+  size_t size() const;
+
+  /// Drops all kept translations.
+  void clear();
+
+ private:
+  friend class TranslationModel;
+  friend class Service;
+
+  /// Drops kept translations if they were translated with a different model.
+  void bind(std::shared_ptr<TranslationModel> model);
+
+  /// Returns the kept history for each sentence in source, nullptr for
+  /// sentences to be translated. onComplete is set to store the histories of
+  /// this revision once translated.
+  Histories lookup(const AnnotatedText &source, std::function<void(const Histories &)> &onComplete);
+
+  struct State {
+#ifndef WASM_COMPATIBLE_SOURCE
+    /// Revisions complete on worker threads.
+    std::mutex mutex;
+#endif
+    /// Model the kept histories were translated with.
+    std::weak_ptr<TranslationModel> model;
+
+    /// Source sentence text to the history of its translation.
+    std::unordered_map<std::string, Ptr<History>> histories;
+
+    /// Number of revisions looked up, and the revision histories are kept of.
+    size_t revisions{0};
+    size_t completedRevision{0};
+  };
+
+  /// Shared with the completion callbacks of queued revisions.
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace bergamot
+}  // namespace marian
+
+#endif  // SRC_BERGAMOT_DOCUMENT_SESSION_H_
@@ -0,0 +1,70 @@
+#include "encoding_cache.h"
+
+namespace marian {
+namespace bergamot {
+
+bool EncodingCache::find(const string_view &sentence, Words &words, std::vector<string_view> &wordRanges) {
+#ifndef WASM_COMPATIBLE_SOURCE
+  std::lock_guard<std::mutex> lock(mutex_);
+#endif
+  auto entry = index_.find(std::string_view(sentence.data(), sentence.size()));
+  if (entry == index_.end()) {
+    ++misses_;
+    return false;
+  }
+  ++hits_;
+
+  // Move to the front, as most recently used.
+  entries_.splice(entries_.begin(), entries_, entry->second);
+  const Encoding &encoding = entry->second->second;
+  words = encoding.words;
+  wordRanges.clear();
+  wordRanges.reserve(encoding.wordRanges.size());
+  for (const ByteRange &range : encoding.wordRanges) {
+    wordRanges.emplace_back(sentence.data() + range.begin, range.size());
+  }
+  return true;
+}
+
+void EncodingCache::insert(const string_view &sentence, const Words &words,
+                           const std::vector<string_view> &wordRanges) {
+  if (capacity_ == 0) {
+    return;
+  }
+
+  Encoding encoding;
+  encoding.words = words;
+  encoding.wordRanges.reserve(wordRanges.size());
+  for (const string_view &range : wordRanges) {
+    size_t begin = range.data() - sentence.data();
+    encoding.wordRanges.push_back(ByteRange{begin, begin + range.size()});
+  }
+
+#ifndef WASM_COMPATIBLE_SOURCE
+  std::lock_guard<std::mutex> lock(mutex_);
+#endif
+  // Another thread may have cached the sentence meanwhile.
+  if (index_.count(std::string_view(sentence.data(), sentence.size())) > 0) {
+    return;
+  }
+  if (entries_.size() == capacity_) {
+    index_.erase(std::string_view(entries_.back().first));
+    entries_.pop_back();
+  }
+  entries_.emplace_front(std::string(sentence.data(), sentence.size()), std::move(encoding));
+  index_.emplace(std::string_view(entries_.front().first), entries_.begin());
+}
+
+EncodingCache::Stats EncodingCache::stats() const {
+#ifndef WASM_COMPATIBLE_SOURCE
+  std::lock_guard<std::mutex> lock(mutex_);
+#endif
+  Stats stats;
+  stats.hits = hits_;
+  stats.misses = misses_;
+  stats.size = entries_.size();
+  return stats;
+}
+
+}  // namespace bergamot
+}  // namespace marian
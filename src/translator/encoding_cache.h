@@ -0,0 +1,78 @@
+#ifndef SRC_BERGAMOT_ENCODING_CACHE_H_
+#define SRC_BERGAMOT_ENCODING_CACHE_H_
+
+#include <list>
+#ifndef WASM_COMPATIBLE_SOURCE
+#include <mutex>
+#endif
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "annotation.h"
+#include "data/types.h"
+#include "definitions.h"
+
+namespace marian {
+namespace bergamot {
+
+/// EncodingCache is a bounded, least-recently-used cache of the SentencePiece
+/// encodings of sentences, for traffic in which the same sentences recur.
+///
+/// Sentences are cached whole, as SentencePiece normalization and
+/// segmentation can depend on context beyond a single word. Word byte ranges
+/// are kept relative to the beginning of the sentence, and rebased onto the
+/// sentence being looked up on a hit.
+///
+/// Safe for concurrent use by multiple pre-processing threads.
+class EncodingCache {
+ public:
+  /// Counters reported by stats().
+  struct Stats {
+    size_t hits{0};    ///< Lookups that found the sentence.
+    size_t misses{0};  ///< Lookups that did not.
+    size_t size{0};    ///< Sentences currently cached.
+  };
+
+  /// @param [in] capacity: maximum number of sentences cached.
+  explicit EncodingCache(size_t capacity) : capacity_(capacity) {}
+
+  /// Looks up sentence. On a hit, sets words to its encoding and wordRanges to
+  /// the byte ranges of the words within sentence, and returns true.
+  bool find(const string_view &sentence, Words &words, std::vector<string_view> &wordRanges);
+
+  /// Caches words and wordRanges (which point into sentence) as the encoding
+  /// of sentence, evicting the least recently used sentence if full.
+  void insert(const string_view &sentence, const Words &words, const std::vector<string_view> &wordRanges);
+
+  Stats stats() const;
+
+ private:
+  struct Encoding {
+    Words words;
+    std::vector<ByteRange> wordRanges;
+  };
+
+  /// Sentences with their encodings, most recently used first.
+  typedef std::list<std::pair<std::string, Encoding>> Entries;
+
+  size_t capacity_;
+  Entries entries_;
+
+  /// Index into entries_, keyed by views of the strings held in entries_.
+  std::unordered_map<std::string_view, Entries::iterator> index_;
+
+  size_t hits_{0};
+  size_t misses_{0};
+
+#ifndef WASM_COMPATIBLE_SOURCE
+  mutable std::mutex mutex_;
+#endif
+};
+
+}  // namespace bergamot
+}  // namespace marian
+
+#endif  // SRC_BERGAMOT_ENCODING_CACHE_H_
@@ -0,0 +1,229 @@
+#include "flat_response.h"
+
+#include <limits>
+
+#include "common/logging.h"
+
+namespace marian {
+namespace bergamot {
+
+namespace {
+
+const uint32_t kMagic = 0x50535242;  // "BRSP" in little-endian.
+
+/// Words in the header: magic, version, numSentences, offsets of source,
+/// target, quality and alignments, reserved.
+enum HeaderWord { MAGIC, VERSION, NUM_SENTENCES, SOURCE, TARGET, QUALITY, ALIGNMENTS, RESERVED, HEADER_WORDS };
+
+/// Bytes per serialized Point: src, tgt and prob, unpadded.
+const size_t kPointSize = 2 * sizeof(WordIndex) + sizeof(float);
+
+template <class T>
+void append(std::string &buffer, T value) {
+  buffer.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void set(std::string &buffer, size_t offset, uint32_t value) { std::memcpy(&buffer[offset], &value, sizeof(value)); }
+
+/// Pads buffer to a multiple of 4 bytes from base.
+void pad(std::string &buffer, size_t base) { buffer.append((4 - (buffer.size() - base) % 4) % 4, '\0'); }
+
+uint32_t checked(size_t value) {
+  ABORT_IF(value > std::numeric_limits<uint32_t>::max(), "Response too large to serialize");
+  return static_cast<uint32_t>(value);
+}
+
+void appendAnnotatedText(const AnnotatedText &text, std::string &buffer) {
+  size_t numSentences = text.numSentences();
+  size_t numTokens = numSentences + 1;
+  for (size_t sentenceIdx = 0; sentenceIdx < numSentences; sentenceIdx++) {
+    numTokens += text.numWords(sentenceIdx);
+  }
+  append(buffer, checked(numTokens));
+
+  // Token begins: each gap followed by the words of the sentence after it,
+  // then the end of the last gap.
+  for (size_t sentenceIdx = 0; sentenceIdx < numSentences; sentenceIdx++) {
+    append(buffer, checked(text.annotation.gap(sentenceIdx).begin));
+    for (size_t wordIdx = 0; wordIdx < text.numWords(sentenceIdx); wordIdx++) {
+      append(buffer, checked(text.wordAsByteRange(sentenceIdx, wordIdx).begin));
+    }
+  }
+  append(buffer, checked(text.annotation.gap(numSentences).begin));
+  append(buffer, checked(text.annotation.gap(numSentences).end));
+
+  size_t gapIndex = 0;
+  for (size_t sentenceIdx = 0; sentenceIdx < numSentences; sentenceIdx++) {
+    append(buffer, checked(gapIndex));
+    gapIndex += 1 + text.numWords(sentenceIdx);
+  }
+  append(buffer, checked(gapIndex));
+
+  string_view view = text.view();
+  append(buffer, checked(view.size()));
+  buffer.append(view.data(), view.size());
+}
+
+}  // namespace
+
+void serializeResponse(const Response &response, std::string &buffer) {
+  size_t base = buffer.size();
+  size_t numSentences = response.size();
+  buffer.append(HEADER_WORDS * sizeof(uint32_t), '\0');
+  set(buffer, base + MAGIC * sizeof(uint32_t), kMagic);
+  set(buffer, base + VERSION * sizeof(uint32_t), FlatResponse::kVersion);
+  set(buffer, base + NUM_SENTENCES * sizeof(uint32_t), checked(numSentences));
+
+  set(buffer, base + SOURCE * sizeof(uint32_t), checked(buffer.size() - base));
+  appendAnnotatedText(response.source, buffer);
+  pad(buffer, base);
+
+  set(buffer, base + TARGET * sizeof(uint32_t), checked(buffer.size() - base));
+  appendAnnotatedText(response.target, buffer);
+  pad(buffer, base);
+
+  if (!response.qualityScores.empty()) {
+    ABORT_IF(response.qualityScores.size() != numSentences, "Mismatch in sentences and quality scores");
+    set(buffer, base + QUALITY * sizeof(uint32_t), checked(buffer.size() - base));
+    for (const Quality &quality : response.qualityScores) {
+      append(buffer, quality.sequence);
+    }
+    size_t offset = 0;
+    for (const Quality &quality : response.qualityScores) {
+      append(buffer, checked(offset));
+      offset += quality.word.size();
+    }
+    append(buffer, checked(offset));
+    for (const Quality &quality : response.qualityScores) {
+      buffer.append(reinterpret_cast<const char *>(quality.word.data()), quality.word.size() * sizeof(float));
+    }
+  }
+
+  if (!response.alignments.empty()) {
+    ABORT_IF(response.alignments.size() != numSentences, "Mismatch in sentences and alignments");
+    set(buffer, base + ALIGNMENTS * sizeof(uint32_t), checked(buffer.size() - base));
+    size_t offset = 0;
+    for (const Alignment &alignment : response.alignments) {
+      append(buffer, checked(offset));
+      offset += alignment.size();
+    }
+    append(buffer, checked(offset));
+    for (const Alignment &alignment : response.alignments) {
+      for (const Point &point : alignment) {
+        append(buffer, point.src);
+        append(buffer, point.tgt);
+        append(buffer, point.prob);
+      }
+    }
+  }
+}
+
+FlatResponse::FlatResponse(string_view buffer) : buffer_(buffer) {
+  checkRange(0, HEADER_WORDS * sizeof(uint32_t));
+  auto header = [this](HeaderWord word) { return FlatAnnotatedText::load(buffer_.data() + word * sizeof(uint32_t)); };
+  ABORT_IF(header(MAGIC) != kMagic, "Not a serialized Response");
+  ABORT_IF(header(VERSION) != kVersion, "Serialized Response has version {}, expected {}", header(VERSION), kVersion);
+  numSentences_ = header(NUM_SENTENCES);
+
+  readAnnotatedText(header(SOURCE), source_);
+  readAnnotatedText(header(TARGET), target_);
+
+  // Offset tables are checked once here, so that accessors need not. Returns
+  // the last offset, the number of entries.
+  auto checkOffsets = [this](size_t offset, size_t count) {
+    checkRange(offset, (count + 1) * sizeof(uint32_t));
+    const char *offsets = buffer_.data() + offset;
+    for (size_t i = 0; i < count; i++) {
+      ABORT_IF(FlatAnnotatedText::load(offsets + i * sizeof(uint32_t)) >
+                   FlatAnnotatedText::load(offsets + (i + 1) * sizeof(uint32_t)),
+               "Corrupt serialized Response");
+    }
+    return size_t(FlatAnnotatedText::load(offsets + count * sizeof(uint32_t)));
+  };
+
+  if (header(QUALITY) != 0) {
+    size_t offsets = header(QUALITY) + numSentences_ * sizeof(float);
+    size_t numScores = checkOffsets(offsets, numSentences_);
+    size_t wordScores = offsets + (numSentences_ + 1) * sizeof(uint32_t);
+    checkRange(wordScores, numScores * sizeof(float));
+    quality_ = buffer_.data() + header(QUALITY);
+    wordScores_ = buffer_.data() + wordScores;
+  }
+
+  if (header(ALIGNMENTS) != 0) {
+    size_t numPoints = checkOffsets(header(ALIGNMENTS), numSentences_);
+    size_t points = header(ALIGNMENTS) + (numSentences_ + 1) * sizeof(uint32_t);
+    checkRange(points, numPoints * kPointSize);
+    alignments_ = buffer_.data() + header(ALIGNMENTS);
+    points_ = buffer_.data() + points;
+  }
+}
+
+void FlatResponse::readAnnotatedText(size_t offset, FlatAnnotatedText &text) const {
+  checkRange(offset, sizeof(uint32_t));
+  size_t numTokens = FlatAnnotatedText::load(buffer_.data() + offset);
+  size_t tokenBegins = offset + sizeof(uint32_t);
+  size_t gaps = tokenBegins + (numTokens + 1) * sizeof(uint32_t);
+  size_t textSize = gaps + (numSentences_ + 1) * sizeof(uint32_t);
+  checkRange(tokenBegins, textSize + sizeof(uint32_t) - tokenBegins);
+  size_t size = FlatAnnotatedText::load(buffer_.data() + textSize);
+  checkRange(textSize + sizeof(uint32_t), size);
+
+  text.numSentences_ = numSentences_;
+  text.tokenBegins_ = buffer_.data() + tokenBegins;
+  text.gaps_ = buffer_.data() + gaps;
+  text.text_ = string_view(buffer_.data() + textSize + sizeof(uint32_t), size);
+
+  // Ranges must be in order and within the text, and gaps within the tokens,
+  // for accessors to stay in bounds.
+  for (size_t tokenIdx = 0; tokenIdx <= numTokens; tokenIdx++) {
+    bool ordered = tokenIdx == 0 || text.tokenBegin(tokenIdx - 1) <= text.tokenBegin(tokenIdx);
+    ABORT_IF(!ordered || text.tokenBegin(tokenIdx) > size, "Corrupt serialized Response");
+  }
+  for (size_t gapIdx = 0; gapIdx <= numSentences_; gapIdx++) {
+    bool ordered = gapIdx == 0 || text.gapIndex(gapIdx - 1) < text.gapIndex(gapIdx);
+    ABORT_IF(!ordered || text.gapIndex(gapIdx) >= numTokens, "Corrupt serialized Response");
+  }
+}
+
+void FlatResponse::checkRange(size_t offset, size_t size) const {
+  ABORT_IF(offset > buffer_.size() || size > buffer_.size() - offset, "Serialized Response is truncated");
+}
+
+float FlatResponse::sequenceQuality(size_t sentenceIdx) const {
+  float score;
+  std::memcpy(&score, quality_ + sentenceIdx * sizeof(float), sizeof(score));
+  return score;
+}
+
+size_t FlatResponse::numWordQualities(size_t sentenceIdx) const {
+  const char *offsets = quality_ + numSentences_ * sizeof(float);
+  return FlatAnnotatedText::load(offsets + (sentenceIdx + 1) * sizeof(uint32_t)) -
+         FlatAnnotatedText::load(offsets + sentenceIdx * sizeof(uint32_t));
+}
+
+float FlatResponse::wordQuality(size_t sentenceIdx, size_t wordIdx) const {
+  const char *offsets = quality_ + numSentences_ * sizeof(float);
+  size_t index = FlatAnnotatedText::load(offsets + sentenceIdx * sizeof(uint32_t)) + wordIdx;
+  float score;
+  std::memcpy(&score, wordScores_ + index * sizeof(float), sizeof(score));
+  return score;
+}
+
+size_t FlatResponse::numPoints(size_t sentenceIdx) const {
+  return FlatAnnotatedText::load(alignments_ + (sentenceIdx + 1) * sizeof(uint32_t)) -
+         FlatAnnotatedText::load(alignments_ + sentenceIdx * sizeof(uint32_t));
+}
+
+Point FlatResponse::point(size_t sentenceIdx, size_t pointIdx) const {
+  size_t index = FlatAnnotatedText::load(alignments_ + sentenceIdx * sizeof(uint32_t)) + pointIdx;
+  const char *p = points_ + index * kPointSize;
+  Point point;
+  std::memcpy(&point.src, p, sizeof(point.src));
+  std::memcpy(&point.tgt, p + sizeof(point.src), sizeof(point.tgt));
+  std::memcpy(&point.prob, p + sizeof(point.src) + sizeof(point.tgt), sizeof(point.prob));
+  return point;
+}
+
+}  // namespace bergamot
+}  // namespace marian
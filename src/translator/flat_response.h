@@ -0,0 +1,153 @@
+#ifndef SRC_BERGAMOT_FLAT_RESPONSE_H_
+#define SRC_BERGAMOT_FLAT_RESPONSE_H_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "annotation.h"
+#include "definitions.h"
+#include "response.h"
+
+namespace marian {
+namespace bergamot {
+
+/// Appends response to buffer in the flat binary format read by FlatResponse,
+/// e.g. to hand it to another process.
+///
+/// The format is a header followed by sections, all 4-byte aligned, in host
+/// byte order (little-endian on all supported platforms):
+///
+/// ```
+///   header:     magic "BRSP", version, numSentences, the offsets of the
+///               sections below from the start of the header (0 if absent),
+///               and a reserved word
+///   source and  numTokens, token begin offsets [numTokens + 1], gap token
+///   target:     indices [numSentences + 1], text size, text
+///   quality:    sequence scores [numSentences], word score offsets
+///               [numSentences + 1], word scores
+///   alignments: point offsets [numSentences + 1], points as src (16 bit),
+///               tgt (16 bit), prob (float)
+/// ```
+///
+/// Token offsets and gap indices are those of Annotation, so a reader answers
+/// word(), sentence() and gap() by indexing, without building anything.
+void serializeResponse(const Response &response, std::string &buffer);
+
+/// Read-only view of an AnnotatedText within a serialized Response. Offers the
+/// accessors of AnnotatedText, answered from the buffer.
+class FlatAnnotatedText {
+ public:
+  FlatAnnotatedText() = default;
+
+  /// The text annotations refer to.
+  string_view view() const { return text_; }
+
+  size_t numSentences() const { return numSentences_; }
+
+  size_t numWords(size_t sentenceIdx) const { return gapIndex(sentenceIdx + 1) - gapIndex(sentenceIdx) - 1; }
+
+  ByteRange wordAsByteRange(size_t sentenceIdx, size_t wordIdx) const {
+    size_t tokenIdx = gapIndex(sentenceIdx) + 1 + wordIdx;
+    return ByteRange{tokenBegin(tokenIdx), tokenBegin(tokenIdx + 1)};
+  }
+
+  ByteRange sentenceAsByteRange(size_t sentenceIdx) const {
+    return ByteRange{tokenBegin(gapIndex(sentenceIdx) + 1), tokenBegin(gapIndex(sentenceIdx + 1))};
+  }
+
+  ByteRange gapAsByteRange(size_t gapIdx) const {
+    size_t tokenIdx = gapIndex(gapIdx);
+    return ByteRange{tokenBegin(tokenIdx), tokenBegin(tokenIdx + 1)};
+  }
+
+  string_view word(size_t sentenceIdx, size_t wordIdx) const {
+    return asStringView(wordAsByteRange(sentenceIdx, wordIdx));
+  }
+
+  string_view sentence(size_t sentenceIdx) const { return asStringView(sentenceAsByteRange(sentenceIdx)); }
+
+  string_view gap(size_t gapIdx) const { return asStringView(gapAsByteRange(gapIdx)); }
+
+ private:
+  friend class FlatResponse;
+
+  size_t tokenBegin(size_t tokenIdx) const { return load(tokenBegins_ + tokenIdx * sizeof(uint32_t)); }
+  size_t gapIndex(size_t gapIdx) const { return load(gaps_ + gapIdx * sizeof(uint32_t)); }
+
+  /// Reads the value at p, which need not be aligned.
+  static uint32_t load(const char *p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+  }
+
+  string_view asStringView(const ByteRange &byteRange) const {
+    return string_view(text_.data() + byteRange.begin, byteRange.size());
+  }
+
+  size_t numSentences_{0};
+  const char *tokenBegins_{nullptr};
+  const char *gaps_{nullptr};
+  string_view text_;
+};
+
+/// Read-only view of a Response serialized by serializeResponse(). Nothing is
+/// copied: accessors read from the buffer, which must outlive the view.
+/// Construction checks the header and that all offsets lie within the buffer,
+/// and aborts if not.
+class FlatResponse {
+ public:
+  /// Version of the format written by serializeResponse().
+  static constexpr uint32_t kVersion = 1;
+
+  explicit FlatResponse(string_view buffer);
+
+  /// Number of sentences, as Response::size().
+  size_t size() const { return numSentences_; }
+
+  const FlatAnnotatedText &source() const { return source_; }
+  const FlatAnnotatedText &target() const { return target_; }
+
+  /// Whether the Response included quality scores and alignments.
+  bool hasQualityScores() const { return quality_ != nullptr; }
+  bool hasAlignments() const { return alignments_ != nullptr; }
+
+  /// Quality::sequence of the sentence at sentenceIdx.
+  float sequenceQuality(size_t sentenceIdx) const;
+
+  /// Number of entries of Quality::word of the sentence at sentenceIdx, and
+  /// the entry at wordIdx.
+  size_t numWordQualities(size_t sentenceIdx) const;
+  float wordQuality(size_t sentenceIdx, size_t wordIdx) const;
+
+  /// Number of points in the alignment of the sentence at sentenceIdx, and
+  /// the point at pointIdx.
+  size_t numPoints(size_t sentenceIdx) const;
+  Point point(size_t sentenceIdx, size_t pointIdx) const;
+
+ private:
+  /// Sets text to the AnnotatedText section at offset, checking its bounds.
+  void readAnnotatedText(size_t offset, FlatAnnotatedText &text) const;
+
+  /// Aborts unless [offset, offset + size) is within the buffer.
+  void checkRange(size_t offset, size_t size) const;
+
+  string_view buffer_;
+  size_t numSentences_;
+  FlatAnnotatedText source_;
+  FlatAnnotatedText target_;
+
+  /// Start of the quality and alignment sections, or nullptr if absent.
+  const char *quality_{nullptr};
+  const char *alignments_{nullptr};
+
+  /// Start of the word scores and points, after their offset tables.
+  const char *wordScores_{nullptr};
+  const char *points_{nullptr};
+};
+
+}  // namespace bergamot
+}  // namespace marian
+
+#endif  // SRC_BERGAMOT_FLAT_RESPONSE_H_
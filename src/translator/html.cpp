@@ -0,0 +1,566 @@
+#include "html.h"
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace marian {
+namespace bergamot {
+
+namespace {
+
+const size_t kNone = std::numeric_limits<size_t>::max();
+
+/// Elements without content or closing tag.
+const std::unordered_set<std::string> kVoidElements = {"area",  "base", "br",   "col",   "embed",  "hr",    "img",
+                                                       "input", "link", "meta", "param", "source", "track", "wbr"};
+
+/// Elements whose content is not text, kept with their opening tag.
+const std::unordered_set<std::string> kRawTextElements = {"script", "style"};
+
+/// Elements that start or end a block of text, which sentences do not cross.
+const std::unordered_set<std::string> kBlockElements = {
+    "address", "article", "aside", "blockquote", "br", "caption", "dd", "div", "dl", "dt", "fieldset", "figcaption",
+    "figure", "footer", "form", "h1", "h2", "h3", "h4", "h5", "h6", "header", "hr", "li", "main", "nav", "ol",
+    "option", "p", "pre", "section", "table", "tbody", "td", "tfoot", "th", "thead", "title", "tr", "ul"};
+
+/// Named character references of HTML 4 (Latin-1, symbols and Greek letters,
+/// markup and typographic characters), and &apos;.
+const std::unordered_map<std::string, char32_t> kNamedReferences = {
+    {"quot", 0x22}, {"amp", 0x26}, {"lt", 0x3C}, {"gt", 0x3E}, {"nbsp", 0xA0}, {"iexcl", 0xA1}, {"cent", 0xA2},
+    {"pound", 0xA3}, {"curren", 0xA4}, {"yen", 0xA5}, {"brvbar", 0xA6}, {"sect", 0xA7}, {"uml", 0xA8}, {"copy", 0xA9},
+    {"ordf", 0xAA}, {"laquo", 0xAB}, {"not", 0xAC}, {"shy", 0xAD}, {"reg", 0xAE}, {"macr", 0xAF}, {"deg", 0xB0},
+    {"plusmn", 0xB1}, {"sup2", 0xB2}, {"sup3", 0xB3}, {"acute", 0xB4}, {"micro", 0xB5}, {"para", 0xB6},
+    {"middot", 0xB7}, {"cedil", 0xB8}, {"sup1", 0xB9}, {"ordm", 0xBA}, {"raquo", 0xBB}, {"frac14", 0xBC},
+    {"frac12", 0xBD}, {"frac34", 0xBE}, {"iquest", 0xBF}, {"Agrave", 0xC0}, {"Aacute", 0xC1}, {"Acirc", 0xC2},
+    {"Atilde", 0xC3}, {"Auml", 0xC4}, {"Aring", 0xC5}, {"AElig", 0xC6}, {"Ccedil", 0xC7}, {"Egrave", 0xC8},
+    {"Eacute", 0xC9}, {"Ecirc", 0xCA}, {"Euml", 0xCB}, {"Igrave", 0xCC}, {"Iacute", 0xCD}, {"Icirc", 0xCE},
+    {"Iuml", 0xCF}, {"ETH", 0xD0}, {"Ntilde", 0xD1}, {"Ograve", 0xD2}, {"Oacute", 0xD3}, {"Ocirc", 0xD4},
+    {"Otilde", 0xD5}, {"Ouml", 0xD6}, {"times", 0xD7}, {"Oslash", 0xD8}, {"Ugrave", 0xD9}, {"Uacute", 0xDA},
+    {"Ucirc", 0xDB}, {"Uuml", 0xDC}, {"Yacute", 0xDD}, {"THORN", 0xDE}, {"szlig", 0xDF}, {"agrave", 0xE0},
+    {"aacute", 0xE1}, {"acirc", 0xE2}, {"atilde", 0xE3}, {"auml", 0xE4}, {"aring", 0xE5}, {"aelig", 0xE6},
+    {"ccedil", 0xE7}, {"egrave", 0xE8}, {"eacute", 0xE9}, {"ecirc", 0xEA}, {"euml", 0xEB}, {"igrave", 0xEC},
+    {"iacute", 0xED}, {"icirc", 0xEE}, {"iuml", 0xEF}, {"eth", 0xF0}, {"ntilde", 0xF1}, {"ograve", 0xF2},
+    {"oacute", 0xF3}, {"ocirc", 0xF4}, {"otilde", 0xF5}, {"ouml", 0xF6}, {"divide", 0xF7}, {"oslash", 0xF8},
+    {"ugrave", 0xF9}, {"uacute", 0xFA}, {"ucirc", 0xFB}, {"uuml", 0xFC}, {"yacute", 0xFD}, {"thorn", 0xFE},
+    {"yuml", 0xFF}, {"OElig", 0x152}, {"oelig", 0x153}, {"Scaron", 0x160}, {"scaron", 0x161}, {"Yuml", 0x178},
+    {"fnof", 0x192}, {"circ", 0x2C6}, {"tilde", 0x2DC}, {"Alpha", 0x391}, {"Beta", 0x392}, {"Gamma", 0x393},
+    {"Delta", 0x394}, {"Epsilon", 0x395}, {"Zeta", 0x396}, {"Eta", 0x397}, {"Theta", 0x398}, {"Iota", 0x399},
+    {"Kappa", 0x39A}, {"Lambda", 0x39B}, {"Mu", 0x39C}, {"Nu", 0x39D}, {"Xi", 0x39E}, {"Omicron", 0x39F}, {"Pi", 0x3A0},
+    {"Rho", 0x3A1}, {"Sigma", 0x3A3}, {"Tau", 0x3A4}, {"Upsilon", 0x3A5}, {"Phi", 0x3A6}, {"Chi", 0x3A7},
+    {"Psi", 0x3A8}, {"Omega", 0x3A9}, {"alpha", 0x3B1}, {"beta", 0x3B2}, {"gamma", 0x3B3}, {"delta", 0x3B4},
+    {"epsilon", 0x3B5}, {"zeta", 0x3B6}, {"eta", 0x3B7}, {"theta", 0x3B8}, {"iota", 0x3B9}, {"kappa", 0x3BA},
+    {"lambda", 0x3BB}, {"mu", 0x3BC}, {"nu", 0x3BD}, {"xi", 0x3BE}, {"omicron", 0x3BF}, {"pi", 0x3C0}, {"rho", 0x3C1},
+    {"sigmaf", 0x3C2}, {"sigma", 0x3C3}, {"tau", 0x3C4}, {"upsilon", 0x3C5}, {"phi", 0x3C6}, {"chi", 0x3C7},
+    {"psi", 0x3C8}, {"omega", 0x3C9}, {"thetasym", 0x3D1}, {"upsih", 0x3D2}, {"piv", 0x3D6}, {"ensp", 0x2002},
+    {"emsp", 0x2003}, {"thinsp", 0x2009}, {"zwnj", 0x200C}, {"zwj", 0x200D}, {"lrm", 0x200E}, {"rlm", 0x200F},
+    {"ndash", 0x2013}, {"mdash", 0x2014}, {"lsquo", 0x2018}, {"rsquo", 0x2019}, {"sbquo", 0x201A}, {"ldquo", 0x201C},
+    {"rdquo", 0x201D}, {"bdquo", 0x201E}, {"dagger", 0x2020}, {"Dagger", 0x2021}, {"bull", 0x2022}, {"hellip", 0x2026},
+    {"permil", 0x2030}, {"prime", 0x2032}, {"Prime", 0x2033}, {"lsaquo", 0x2039}, {"rsaquo", 0x203A}, {"oline", 0x203E},
+    {"frasl", 0x2044}, {"euro", 0x20AC}, {"image", 0x2111}, {"weierp", 0x2118}, {"real", 0x211C}, {"trade", 0x2122},
+    {"alefsym", 0x2135}, {"larr", 0x2190}, {"uarr", 0x2191}, {"rarr", 0x2192}, {"darr", 0x2193}, {"harr", 0x2194},
+    {"crarr", 0x21B5}, {"lArr", 0x21D0}, {"uArr", 0x21D1}, {"rArr", 0x21D2}, {"dArr", 0x21D3}, {"hArr", 0x21D4},
+    {"forall", 0x2200}, {"part", 0x2202}, {"exist", 0x2203}, {"empty", 0x2205}, {"nabla", 0x2207}, {"isin", 0x2208},
+    {"notin", 0x2209}, {"ni", 0x220B}, {"prod", 0x220F}, {"sum", 0x2211}, {"minus", 0x2212}, {"lowast", 0x2217},
+    {"radic", 0x221A}, {"prop", 0x221D}, {"infin", 0x221E}, {"ang", 0x2220}, {"and", 0x2227}, {"or", 0x2228},
+    {"cap", 0x2229}, {"cup", 0x222A}, {"int", 0x222B}, {"there4", 0x2234}, {"sim", 0x223C}, {"cong", 0x2245},
+    {"asymp", 0x2248}, {"ne", 0x2260}, {"equiv", 0x2261}, {"le", 0x2264}, {"ge", 0x2265}, {"sub", 0x2282},
+    {"sup", 0x2283}, {"nsub", 0x2284}, {"sube", 0x2286}, {"supe", 0x2287}, {"oplus", 0x2295}, {"otimes", 0x2297},
+    {"perp", 0x22A5}, {"sdot", 0x22C5}, {"lceil", 0x2308}, {"rceil", 0x2309}, {"lfloor", 0x230A}, {"rfloor", 0x230B},
+    {"lang", 0x2329}, {"rang", 0x232A}, {"loz", 0x25CA}, {"spades", 0x2660}, {"clubs", 0x2663}, {"hearts", 0x2665},
+    {"diams", 0x2666},
+    {"apos", 0x27}};
+
+/// Line break inserted into text content for block-level tags.
+const std::string kBlockBreak = "\n\n";
+
+bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v'; }
+
+std::string toLower(std::string text) {
+  for (char &c : text) {
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  return text;
+}
+
+void appendUTF8(char32_t c, std::string &out) {
+  if (c < 0x80) {
+    out += static_cast<char>(c);
+  } else if (c < 0x800) {
+    out += static_cast<char>(0xC0 | (c >> 6));
+    out += static_cast<char>(0x80 | (c & 0x3F));
+  } else if (c < 0x10000) {
+    out += static_cast<char>(0xE0 | (c >> 12));
+    out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (c & 0x3F));
+  } else {
+    out += static_cast<char>(0xF0 | (c >> 18));
+    out += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+    out += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+    out += static_cast<char>(0x80 | (c & 0x3F));
+  }
+}
+
+/// Decodes the character reference starting at html[begin], which is '&',
+/// into decoded and sets end past it. Returns false for anything but numeric
+/// references and the named references of kNamedReferences, terminated by a
+/// semicolon, which are then left as text.
+bool decodeCharacterReference(const std::string &html, size_t begin, size_t &end, std::string &decoded) {
+  size_t semicolon = html.find(';', begin + 1);
+  if (semicolon == std::string::npos || semicolon - begin > 10) {
+    return false;
+  }
+  std::string name = html.substr(begin + 1, semicolon - begin - 1);
+  decoded.clear();
+  if (name.size() > 1 && name[0] == '#') {
+    bool hex = name[1] == 'x' || name[1] == 'X';
+    std::string digits = name.substr(hex ? 2 : 1);
+    const char *valid = hex ? "0123456789abcdefABCDEF" : "0123456789";
+    if (digits.empty() || digits.find_first_not_of(valid) != std::string::npos) {
+      return false;
+    }
+    unsigned long c = std::stoul(digits, nullptr, hex ? 16 : 10);
+    if (c == 0 || c > 0x10FFFF) {
+      return false;
+    }
+    appendUTF8(static_cast<char32_t>(c), decoded);
+  } else {
+    auto reference = kNamedReferences.find(name);
+    if (reference == kNamedReferences.end()) {
+      return false;
+    }
+    appendUTF8(reference->second, decoded);
+  }
+  end = semicolon + 1;
+  return true;
+}
+
+/// Appends text to out with markup characters escaped.
+void appendEscaped(string_view text, std::string &out) {
+  for (char c : text) {
+    switch (c) {
+      case '&':
+        out += "&amp;";
+        break;
+      case '<':
+        out += "&lt;";
+        break;
+      case '>':
+        out += "&gt;";
+        break;
+      default:
+        out += c;
+    }
+  }
+}
+
+}  // namespace
+
+HTML::HTML(std::string &source) : original_(std::move(source)) {
+  std::string text;
+  text.reserve(original_.size());
+
+  // Elements opened and not yet closed, innermost last.
+  std::vector<std::pair<size_t, std::string>> open;
+
+  size_t begin = 0;
+  while (begin < original_.size()) {
+    size_t end;
+    TagType type;
+    std::string name;
+    std::string decoded;
+    if (original_[begin] == '<' && parseTag(begin, end, type, name)) {
+      size_t tagIdx = tags_.size();
+      tags_.push_back(Tag{type, ByteRange{begin, end}, text.size(), kNone});
+      Tag &tag = tags_.back();
+      if (type == OPEN) {
+        tag.element = elements_.size();
+        elements_.push_back(Element{tagIdx, kNone});
+        open.emplace_back(tag.element, name);
+      } else if (type == CLOSE) {
+        // Elements opened after the one closed are left unmatched, as if
+        // closed implicitly.
+        auto opened = std::find_if(open.rbegin(), open.rend(), [&name](const auto &element) {
+          return element.second == name;
+        });
+        if (opened != open.rend()) {
+          tag.element = opened->first;
+          elements_[tag.element].close = tagIdx;
+          open.erase(std::next(opened).base(), open.end());
+        } else {
+          tag.type = POINT;
+        }
+      }
+      bool broken = text.size() >= kBlockBreak.size() &&
+                    text.compare(text.size() - kBlockBreak.size(), kBlockBreak.size(), kBlockBreak) == 0;
+      if (kBlockElements.count(name) && !text.empty() && !broken) {
+        spans_.push_back(Span{ByteRange{text.size(), text.size() + kBlockBreak.size()}, ByteRange{end, end}, false});
+        text += kBlockBreak;
+      }
+    } else if (original_[begin] == '&' && decodeCharacterReference(original_, begin, end, decoded)) {
+      spans_.push_back(Span{ByteRange{text.size(), text.size() + decoded.size()}, ByteRange{begin, end}, false});
+      text += decoded;
+    } else {
+      end = std::min(original_.find_first_of("<&", begin + 1), original_.size());
+      if (!spans_.empty() && spans_.back().verbatim && spans_.back().original.end == begin) {
+        spans_.back().text.end += end - begin;
+        spans_.back().original.end = end;
+      } else {
+        spans_.push_back(Span{ByteRange{text.size(), text.size() + end - begin}, ByteRange{begin, end}, true});
+      }
+      text.append(original_, begin, end - begin);
+    }
+    begin = end;
+  }
+
+  for (const Element &element : elements_) {
+    if (element.close == kNone) {
+      tags_[element.open].type = POINT;
+    }
+  }
+  source = std::move(text);
+}
+
+bool HTML::parseTag(size_t begin, size_t &end, TagType &type, std::string &name) const {
+  const std::string &html = original_;
+  name.clear();
+  type = POINT;
+  if (html.compare(begin, 4, "<!--") == 0) {
+    size_t close = html.find("-->", begin + 4);
+    end = (close == std::string::npos) ? html.size() : close + 3;
+    return true;
+  }
+
+  size_t p = begin + 1;
+  if (p < html.size() && (html[p] == '!' || html[p] == '?')) {
+    // Doctype or processing instruction.
+    size_t close = html.find('>', p);
+    if (close == std::string::npos) {
+      return false;
+    }
+    end = close + 1;
+    return true;
+  }
+
+  bool closing = p < html.size() && html[p] == '/';
+  if (closing) {
+    p++;
+  }
+  if (p == html.size() || !std::isalpha(static_cast<unsigned char>(html[p]))) {
+    return false;
+  }
+  size_t nameBegin = p;
+  while (p < html.size() && (std::isalnum(static_cast<unsigned char>(html[p])) || html[p] == '-' || html[p] == ':')) {
+    p++;
+  }
+  name = toLower(html.substr(nameBegin, p - nameBegin));
+
+  // Attributes, whose quoted values may contain '>'.
+  char quote = 0;
+  for (; p < html.size(); p++) {
+    if (quote != 0) {
+      quote = (html[p] == quote) ? 0 : quote;
+    } else if (html[p] == '"' || html[p] == '\'') {
+      quote = html[p];
+    } else if (html[p] == '>') {
+      break;
+    }
+  }
+  if (p == html.size()) {
+    return false;
+  }
+  end = p + 1;
+
+  if (closing) {
+    type = CLOSE;
+  } else if (html[p - 1] == '/' || kVoidElements.count(name)) {
+    type = POINT;
+  } else if (kRawTextElements.count(name)) {
+    // The content and closing tag are kept with the opening tag. The closing
+    // tag is found in place, in any case: name is lower case.
+    std::string closeTag = "</" + name;
+    auto close = std::search(html.begin() + end, html.end(), closeTag.begin(), closeTag.end(), [](char c, char lower) {
+      return std::tolower(static_cast<unsigned char>(c)) == lower;
+    });
+    size_t closeEnd = (close == html.end()) ? std::string::npos : html.find('>', close - html.begin());
+    end = (closeEnd == std::string::npos) ? html.size() : closeEnd + 1;
+    type = POINT;
+  } else {
+    type = OPEN;
+  }
+  return true;
+}
+
+size_t HTML::originalBefore(size_t offset) const {
+  // Last span starting before offset.
+  auto span = std::lower_bound(spans_.begin(), spans_.end(), offset,
+                               [](const Span &span, size_t offset) { return span.text.begin < offset; });
+  if (span == spans_.begin()) {
+    return 0;
+  }
+  --span;
+  if (span->verbatim) {
+    return span->original.begin + std::min(offset, span->text.end) - span->text.begin;
+  }
+  return (offset >= span->text.end) ? span->original.end : span->original.begin;
+}
+
+size_t HTML::originalAfter(size_t offset) const {
+  // First span ending after offset.
+  auto span = std::upper_bound(spans_.begin(), spans_.end(), offset,
+                               [](size_t offset, const Span &span) { return offset < span.text.end; });
+  if (span == spans_.end()) {
+    return original_.size();
+  }
+  if (span->verbatim) {
+    return span->original.begin + offset - span->text.begin;
+  }
+  return (offset == span->text.begin) ? span->original.begin : span->original.end;
+}
+
+void HTML::restore(Response &response) {
+  const AnnotatedText &source = response.source;
+  size_t numSentences = source.numSentences();
+
+  // Finds the sentence whose range contains position, including either end if
+  // asked to.
+  auto sentenceAt = [&source, numSentences](size_t position, bool includeBegin, bool includeEnd) {
+    size_t lo = 0, hi = numSentences;
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      size_t begin = source.annotation.sentence(mid).begin;
+      if (begin < position || (includeBegin && begin == position)) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    if (lo == 0) {
+      return kNone;
+    }
+    ByteRange sentence = source.annotation.sentence(lo - 1);
+    bool inside = (position > sentence.begin || (includeBegin && position == sentence.begin)) &&
+                  (position < sentence.end || (includeEnd && position == sentence.end));
+    return inside ? lo - 1 : kNone;
+  };
+
+  // Elements opened and closed within a sentence enclose its words. Other tags
+  // are restored as they are, in the sentence they are in or the gap.
+  std::vector<size_t> tagSentences(tags_.size(), kNone);
+  std::vector<bool> inlineElements(elements_.size(), false);
+  for (size_t elementIdx = 0; elementIdx < elements_.size(); elementIdx++) {
+    const Element &element = elements_[elementIdx];
+    if (element.close == kNone) {
+      continue;
+    }
+    size_t opened = sentenceAt(tags_[element.open].position, /*includeBegin=*/true, /*includeEnd=*/false);
+    size_t closed = sentenceAt(tags_[element.close].position, /*includeBegin=*/false, /*includeEnd=*/true);
+    if (opened != kNone && opened == closed) {
+      inlineElements[elementIdx] = true;
+      tagSentences[element.open] = tagSentences[element.close] = opened;
+    }
+  }
+  std::vector<std::vector<size_t>> sentenceTags(numSentences);
+  for (size_t tagIdx = 0; tagIdx < tags_.size(); tagIdx++) {
+    if (tagSentences[tagIdx] == kNone) {
+      tagSentences[tagIdx] = sentenceAt(tags_[tagIdx].position, /*includeBegin=*/false, /*includeEnd=*/false);
+    }
+    if (tagSentences[tagIdx] != kNone) {
+      sentenceTags[tagSentences[tagIdx]].push_back(tagIdx);
+    }
+  }
+
+  // Sentences without words have their markup carried into the next gap.
+  AnnotatedText target;
+  std::string pending;
+  for (size_t sentenceIdx = 0; sentenceIdx < numSentences; sentenceIdx++) {
+    std::string buffer;
+    std::vector<size_t> wordEnds;
+    restoreSentence(response, sentenceIdx, sentenceTags[sentenceIdx], inlineElements, buffer, wordEnds);
+
+    std::string prefix = pending + gap(source, sentenceIdx, tagSentences);
+    pending.clear();
+    std::vector<string_view> words;
+    size_t wordBegin = 0;
+    for (size_t wordEnd : wordEnds) {
+      words.emplace_back(buffer.data() + wordBegin, wordEnd - wordBegin);
+      wordBegin = wordEnd;
+    }
+    if (words.empty()) {
+      pending = std::move(buffer);
+    }
+    target.appendSentence(prefix, words.begin(), words.end());
+  }
+  target.appendEndingWhitespace(pending + gap(source, numSentences, tagSentences));
+
+  // Source sentences and words are annotated where they are in the HTML, with
+  // tags before a word (and markup of character references) part of it.
+  AnnotatedText restored(std::move(original_));
+  for (size_t sentenceIdx = 0; sentenceIdx < numSentences; sentenceIdx++) {
+    ByteRange sentence = source.annotation.sentence(sentenceIdx);
+    size_t sentenceBegin = originalAfter(sentence.begin);
+    size_t sentenceEnd = std::max(sentenceBegin, originalBefore(sentence.end));
+    std::vector<string_view> words;
+    for (size_t wordIdx = 0; wordIdx < source.numWords(sentenceIdx); wordIdx++) {
+      size_t begin = (wordIdx == 0) ? sentenceBegin : words.back().data() + words.back().size() - restored.text.data();
+      size_t end = (wordIdx + 1 == source.numWords(sentenceIdx))
+                       ? sentenceEnd
+                       : originalAfter(source.annotation.word(sentenceIdx, wordIdx + 1).begin);
+      end = std::max(begin, std::min(end, sentenceEnd));
+      words.emplace_back(restored.text.data() + begin, end - begin);
+    }
+    restored.recordExistingSentence(words.begin(), words.end(), restored.text.data() + sentenceBegin);
+  }
+
+  response.source = std::move(restored);
+  response.target = std::move(target);
+}
+
+std::string HTML::gap(const AnnotatedText &source, size_t gapIdx, const std::vector<size_t> &tagSentences) const {
+  size_t begin = (gapIdx == 0) ? 0 : originalBefore(source.annotation.sentence(gapIdx - 1).end);
+  size_t end =
+      (gapIdx == source.numSentences()) ? original_.size() : originalAfter(source.annotation.sentence(gapIdx).begin);
+
+  std::string gap;
+  size_t copied = begin;
+  auto tag = std::lower_bound(tags_.begin(), tags_.end(), begin,
+                              [](const Tag &tag, size_t offset) { return tag.original.begin < offset; });
+  for (; tag != tags_.end() && tag->original.begin < end; ++tag) {
+    if (tagSentences[tag - tags_.begin()] != kNone) {
+      gap.append(original_, copied, tag->original.begin - copied);
+      copied = tag->original.end;
+    }
+  }
+  gap.append(original_, copied, end - copied);
+  return gap;
+}
+
+void HTML::restoreSentence(const Response &response, size_t sentenceIdx, const std::vector<size_t> &tags,
+                           const std::vector<bool> &inlineElements, std::string &buffer,
+                           std::vector<size_t> &wordEnds) const {
+  const AnnotatedText &source = response.source;
+  const AnnotatedText &target = response.target;
+  string_view text = source.view();
+  size_t numSourceWords = source.numWords(sentenceIdx);
+  size_t numTargetWords = target.numWords(sentenceIdx);
+
+  // Where each source word starts, past whitespace.
+  std::vector<size_t> positions(numSourceWords);
+  for (size_t wordIdx = 0; wordIdx < numSourceWords; wordIdx++) {
+    ByteRange word = source.annotation.word(sentenceIdx, wordIdx);
+    size_t position = word.begin;
+    while (position < word.end && isSpace(text[position])) {
+      position++;
+    }
+    positions[wordIdx] = (position == word.end) ? word.begin : position;
+  }
+
+  // Source word each target word is aligned to most. Target words without
+  // alignment go with the word before them.
+  std::vector<size_t> aligned(numTargetWords, kNone);
+  if (sentenceIdx < response.alignments.size()) {
+    std::vector<float> best(numTargetWords, -1.0f);
+    for (const Point &point : response.alignments[sentenceIdx]) {
+      if (point.tgt < numTargetWords && point.src < numSourceWords && point.prob > best[point.tgt]) {
+        best[point.tgt] = point.prob;
+        aligned[point.tgt] = point.src;
+      }
+    }
+  }
+  for (size_t wordIdx = 0; wordIdx < numTargetWords && numSourceWords > 0; wordIdx++) {
+    if (aligned[wordIdx] == kNone) {
+      aligned[wordIdx] = (wordIdx == 0) ? 0 : aligned[wordIdx - 1];
+    }
+  }
+
+  // Elements enclosing each source word, outermost first.
+  std::vector<std::vector<size_t>> enclosing(numSourceWords);
+  for (size_t tagIdx : tags) {
+    const Tag &tag = tags_[tagIdx];
+    if (tag.type != OPEN || !inlineElements[tag.element]) {
+      continue;
+    }
+    size_t close = tags_[elements_[tag.element].close].position;
+    for (size_t wordIdx = 0; wordIdx < numSourceWords; wordIdx++) {
+      if (tag.position <= positions[wordIdx] && positions[wordIdx] < close) {
+        enclosing[wordIdx].push_back(tag.element);
+      }
+    }
+  }
+  std::set<size_t> restored;
+  for (size_t sourceIdx : aligned) {
+    if (sourceIdx != kNone) {
+      restored.insert(enclosing[sourceIdx].begin(), enclosing[sourceIdx].end());
+    }
+  }
+
+  // Other tags (including those of elements no target word ended up in) go
+  // before the first target word aligned to the source word they precede.
+  std::vector<std::vector<size_t>> tagsBefore(numTargetWords + 1);
+  for (size_t tagIdx : tags) {
+    const Tag &tag = tags_[tagIdx];
+    if (tag.type != POINT && inlineElements[tag.element] && restored.count(tag.element)) {
+      continue;
+    }
+    size_t anchor = std::lower_bound(positions.begin(), positions.end(), tag.position) - positions.begin();
+    size_t before = numTargetWords;
+    for (size_t wordIdx = 0; wordIdx < numTargetWords; wordIdx++) {
+      if (aligned[wordIdx] == anchor) {
+        before = wordIdx;
+        break;
+      }
+      if (aligned[wordIdx] != kNone && aligned[wordIdx] > anchor && before == numTargetWords) {
+        before = wordIdx;
+      }
+    }
+    tagsBefore[before].push_back(tagIdx);
+  }
+
+  const std::vector<size_t> none;
+  std::vector<size_t> current;
+  for (size_t wordIdx = 0; wordIdx <= numTargetWords; wordIdx++) {
+    const std::vector<size_t> &next =
+        (wordIdx < numTargetWords && aligned[wordIdx] != kNone) ? enclosing[aligned[wordIdx]] : none;
+    size_t common = 0;
+    while (common < current.size() && common < next.size() && current[common] == next[common]) {
+      common++;
+    }
+    for (size_t depth = current.size(); depth > common; depth--) {
+      string_view close = markup(elements_[current[depth - 1]].close);
+      buffer.append(close.data(), close.size());
+    }
+    for (size_t tagIdx : tagsBefore[wordIdx]) {
+      string_view tag = markup(tagIdx);
+      buffer.append(tag.data(), tag.size());
+    }
+    if (wordIdx == numTargetWords) {
+      if (!wordEnds.empty()) {
+        wordEnds.back() = buffer.size();
+      }
+      break;
+    }
+
+    // Closing tags go before the whitespace starting a word, opening tags
+    // after it.
+    string_view word = target.word(sentenceIdx, wordIdx);
+    size_t space = 0;
+    while (space < word.size() && isSpace(word[space])) {
+      space++;
+    }
+    buffer.append(word.data(), space);
+    for (size_t depth = common; depth < next.size(); depth++) {
+      string_view open = markup(elements_[next[depth]].open);
+      buffer.append(open.data(), open.size());
+    }
+    appendEscaped(word.substr(space), buffer);
+    wordEnds.push_back(buffer.size());
+    current = next;
+  }
+}
+
+}  // namespace bergamot
+}  // namespace marian
@@ -0,0 +1,116 @@
+#ifndef SRC_BERGAMOT_HTML_H_
+#define SRC_BERGAMOT_HTML_H_
+
+#include <string>
+#include <vector>
+
+#include "annotation.h"
+#include "response.h"
+
+namespace marian {
+namespace bergamot {
+
+/// HTML separates the markup of an HTML text from the text to translate, and
+/// puts it back into the Response.
+///
+/// Constructing HTML replaces the source with its text content: tags, comments
+/// and the content of script and style elements are removed, and character
+/// references are decoded. Block-level tags (paragraphs, list items, line
+/// breaks...) are replaced by an empty line, so that sentences do not cross
+/// them in any ssplit-mode. Only that text is split, tokenized and translated.
+/// Numeric character references and the named ones of HTML 4 (and &apos;) are
+/// decoded; other named references, such as those HTML5 added or ones missing
+/// their semicolon, are left as text.
+///
+/// restore() maps the Response back onto the HTML. The source is the original
+/// HTML, with sentences and words annotated at their place in it. Tags and
+/// whitespace between sentences are copied to the target as they are. Within a
+/// sentence, every target word is placed in the elements enclosing the source
+/// word it is aligned to most, opening and closing tags as needed; tags that
+/// do not enclose words (such as `<br>`, `<img>` or elements crossing sentences)
+/// are placed before the first target word aligned to the source word they
+/// precede. Translated text is escaped. Without alignments, all target words
+/// are placed as the first source word.
+class HTML {
+ public:
+  /// Replaces source with its text content, keeping the markup to restore.
+  explicit HTML(std::string &source);
+
+  /// Restores markup in source and target of response, which was translated
+  /// from the text content of source as left by the constructor. Call once.
+  void restore(Response &response);
+
+ private:
+  enum TagType {
+    /// Opening tag of an element closed by a CLOSE tag.
+    OPEN,
+
+    /// Closing tag of an element.
+    CLOSE,
+
+    /// Tag that is not part of a matched pair: void elements, comments,
+    /// doctype, script and style elements, and unmatched tags.
+    POINT
+  };
+
+  struct Tag {
+    TagType type;
+    /// Where the tag is in the original HTML.
+    ByteRange original;
+    /// Offset in text content the tag appears at.
+    size_t position;
+    /// Index of the element in elements_, for OPEN and CLOSE.
+    size_t element;
+  };
+
+  struct Element {
+    /// Indices of the opening and closing tag in tags_.
+    size_t open;
+    size_t close;
+  };
+
+  /// Range of text content and the original HTML it was taken from. Text is
+  /// copied verbatim, so offsets map linearly. A decoded character reference,
+  /// or a line break inserted for a block-level tag (with an empty original
+  /// range), maps as a whole.
+  struct Span {
+    ByteRange text;
+    ByteRange original;
+    bool verbatim;
+  };
+
+  /// Parses a tag starting at original_[begin], which is '<'. Sets end past
+  /// the tag and returns true, or false if '<' does not start a tag.
+  bool parseTag(size_t begin, size_t &end, TagType &type, std::string &name) const;
+
+  /// Offset in the original HTML of offset in text content, before or after
+  /// any tags at offset.
+  size_t originalBefore(size_t offset) const;
+  size_t originalAfter(size_t offset) const;
+
+  /// Original HTML between sentences (or at either end), without the tags
+  /// that are restored within sentences.
+  std::string gap(const AnnotatedText &source, size_t gapIdx, const std::vector<size_t> &tagSentences) const;
+
+  /// Builds the words of the target sentence sentenceIdx with markup into
+  /// buffer, setting wordEnds to the end of each word in buffer. tags are the
+  /// tags within the sentence, in order.
+  void restoreSentence(const Response &response, size_t sentenceIdx, const std::vector<size_t> &tags,
+                       const std::vector<bool> &inlineElements, std::string &buffer,
+                       std::vector<size_t> &wordEnds) const;
+
+  /// Markup of the tag at tagIdx.
+  string_view markup(size_t tagIdx) const {
+    return string_view(original_.data() + tags_[tagIdx].original.begin, tags_[tagIdx].original.size());
+  }
+
+  std::string original_;
+  std::vector<Tag> tags_;
+  std::vector<Element> elements_;
+  std::vector<Span> spans_;
+};
+
+}  // namespace bergamot
+}  // namespace marian
+
+#endif  // SRC_BERGAMOT_HTML_H_
@@ -0,0 +1,511 @@
+#include "native_sentence_splitter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <fstream>
+
+#include "common/logging.h"
+
+namespace marian {
+namespace bergamot {
+
+namespace {
+
+bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v'; }
+
+bool isContinuation(char c) { return (static_cast<unsigned char>(c) & 0xC0) == 0x80; }
+
+/// Decodes the UTF-8 character starting at p, setting next past it. Malformed
+/// bytes decode as themselves, one at a time.
+char32_t decode(const char *p, const char *end, const char *&next) {
+  unsigned char lead = static_cast<unsigned char>(*p);
+  size_t length = lead < 0xC0 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+  if (length == 1 || end - p < static_cast<ptrdiff_t>(length)) {
+    next = p + 1;
+    return lead;
+  }
+  char32_t c = lead & (0x3F >> (length - 1));
+  for (size_t i = 1; i < length; i++) {
+    if (!isContinuation(p[i])) {
+      next = p + 1;
+      return lead;
+    }
+    c = (c << 6) | (static_cast<unsigned char>(p[i]) & 0x3F);
+  }
+  next = p + length;
+  return c;
+}
+
+/// Decodes the UTF-8 character ending right before end, setting start to its
+/// first byte.
+char32_t decodeBackwards(const char *begin, const char *end, const char *&start) {
+  start = end - 1;
+  while (start > begin && end - start < 4 && isContinuation(*start)) {
+    start--;
+  }
+  const char *next;
+  char32_t c = decode(start, end, next);
+  if (next != end) {
+    // Not a well-formed character, take the last byte alone.
+    start = end - 1;
+    return static_cast<unsigned char>(*start);
+  }
+  return c;
+}
+
+/// Quotes and brackets that may open a sentence: ASCII ones, inverted marks
+/// and initial punctuation (Unicode category Pi).
+bool isOpening(char32_t c) {
+  switch (c) {
+    case '\'':
+    case '"':
+    case '(':
+    case '[':
+    case 0xBF:  // ¿
+    case 0xA1:  // ¡
+    case 0xAB:
+    case 0x2018:
+    case 0x201B:
+    case 0x201C:
+    case 0x201F:
+    case 0x2039:
+    case 0x2E02:
+    case 0x2E04:
+    case 0x2E09:
+    case 0x2E0C:
+    case 0x2E1C:
+    case 0x2E20:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/// Quotes and brackets that may close a sentence: ASCII ones and final
+/// punctuation (Unicode category Pf).
+bool isClosing(char32_t c) {
+  switch (c) {
+    case '\'':
+    case '"':
+    case ')':
+    case ']':
+    case 0xBB:
+    case 0x2019:
+    case 0x201D:
+    case 0x203A:
+    case 0x2E03:
+    case 0x2E05:
+    case 0x2E0A:
+    case 0x2E0D:
+    case 0x2E1D:
+    case 0x2E21:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/// Code points first, first + step, ..., last.
+struct Run {
+  char32_t first;
+  char32_t last;
+  uint8_t step;
+};
+
+/// Upper case outside ASCII: Unicode property Uppercase, which is \p{Upper}
+/// in the Perl regular expressions of the Moses splitter (Unicode 14.0).
+const Run kUpper[] = {
+    {0xC0, 0xD6, 1}, {0xD8, 0xDE, 1}, {0x100, 0x136, 2}, {0x139, 0x147, 2}, {0x14A, 0x178, 2}, {0x179, 0x17D, 2},
+    {0x181, 0x182, 1}, {0x184, 0x186, 2}, {0x187, 0x189, 2}, {0x18A, 0x18B, 1}, {0x18E, 0x191, 1}, {0x193, 0x194, 1},
+    {0x196, 0x198, 1}, {0x19C, 0x19D, 1}, {0x19F, 0x1A0, 1}, {0x1A2, 0x1A6, 2}, {0x1A7, 0x1A9, 2}, {0x1AC, 0x1AE, 2},
+    {0x1AF, 0x1B1, 2}, {0x1B2, 0x1B3, 1}, {0x1B5, 0x1B7, 2}, {0x1B8, 0x1B8, 1}, {0x1BC, 0x1BC, 1}, {0x1C4, 0x1C4, 1},
+    {0x1C7, 0x1C7, 1}, {0x1CA, 0x1CA, 1}, {0x1CD, 0x1DB, 2}, {0x1DE, 0x1EE, 2}, {0x1F1, 0x1F1, 1}, {0x1F4, 0x1F6, 2},
+    {0x1F7, 0x1F8, 1}, {0x1FA, 0x232, 2}, {0x23A, 0x23B, 1}, {0x23D, 0x23E, 1}, {0x241, 0x243, 2}, {0x244, 0x246, 1},
+    {0x248, 0x24E, 2}, {0x370, 0x372, 2}, {0x376, 0x376, 1}, {0x37F, 0x37F, 1}, {0x386, 0x388, 2}, {0x389, 0x38A, 1},
+    {0x38C, 0x38E, 2}, {0x38F, 0x391, 2}, {0x392, 0x3A1, 1}, {0x3A3, 0x3AB, 1}, {0x3CF, 0x3CF, 1}, {0x3D2, 0x3D4, 1},
+    {0x3D8, 0x3EE, 2}, {0x3F4, 0x3F4, 1}, {0x3F7, 0x3F9, 2}, {0x3FA, 0x3FA, 1}, {0x3FD, 0x42F, 1}, {0x460, 0x480, 2},
+    {0x48A, 0x4C0, 2}, {0x4C1, 0x4CD, 2}, {0x4D0, 0x52E, 2}, {0x531, 0x556, 1}, {0x10A0, 0x10C5, 1},
+    {0x10C7, 0x10C7, 1}, {0x10CD, 0x10CD, 1}, {0x13A0, 0x13F5, 1}, {0x1C90, 0x1CBA, 1}, {0x1CBD, 0x1CBF, 1},
+    {0x1E00, 0x1E94, 2}, {0x1E9E, 0x1EFE, 2}, {0x1F08, 0x1F0F, 1}, {0x1F18, 0x1F1D, 1}, {0x1F28, 0x1F2F, 1},
+    {0x1F38, 0x1F3F, 1}, {0x1F48, 0x1F4D, 1}, {0x1F59, 0x1F5F, 2}, {0x1F68, 0x1F6F, 1}, {0x1FB8, 0x1FBB, 1},
+    {0x1FC8, 0x1FCB, 1}, {0x1FD8, 0x1FDB, 1}, {0x1FE8, 0x1FEC, 1}, {0x1FF8, 0x1FFB, 1}, {0x2102, 0x2102, 1},
+    {0x2107, 0x2107, 1}, {0x210B, 0x210D, 1}, {0x2110, 0x2112, 1}, {0x2115, 0x2115, 1}, {0x2119, 0x211D, 1},
+    {0x2124, 0x212A, 2}, {0x212B, 0x212D, 1}, {0x2130, 0x2133, 1}, {0x213E, 0x213F, 1}, {0x2145, 0x2145, 1},
+    {0x2160, 0x216F, 1}, {0x2183, 0x2183, 1}, {0x24B6, 0x24CF, 1}, {0x2C00, 0x2C2F, 1}, {0x2C60, 0x2C62, 2},
+    {0x2C63, 0x2C64, 1}, {0x2C67, 0x2C6D, 2}, {0x2C6E, 0x2C70, 1}, {0x2C72, 0x2C72, 1}, {0x2C75, 0x2C75, 1},
+    {0x2C7E, 0x2C80, 1}, {0x2C82, 0x2CE2, 2}, {0x2CEB, 0x2CED, 2}, {0x2CF2, 0x2CF2, 1}, {0xA640, 0xA66C, 2},
+    {0xA680, 0xA69A, 2}, {0xA722, 0xA72E, 2}, {0xA732, 0xA76E, 2}, {0xA779, 0xA77D, 2}, {0xA77E, 0xA786, 2},
+    {0xA78B, 0xA78D, 2}, {0xA790, 0xA792, 2}, {0xA796, 0xA7AA, 2}, {0xA7AB, 0xA7AE, 1}, {0xA7B0, 0xA7B4, 1},
+    {0xA7B6, 0xA7C4, 2}, {0xA7C5, 0xA7C7, 1}, {0xA7C9, 0xA7C9, 1}, {0xA7D0, 0xA7D0, 1}, {0xA7D6, 0xA7D8, 2},
+    {0xA7F5, 0xA7F5, 1}, {0xFF21, 0xFF3A, 1}, {0x10400, 0x10427, 1}, {0x104B0, 0x104D3, 1}, {0x10570, 0x1057A, 1},
+    {0x1057C, 0x1058A, 1}, {0x1058C, 0x10592, 1}, {0x10594, 0x10595, 1}, {0x10C80, 0x10CB2, 1}, {0x118A0, 0x118BF, 1},
+    {0x16E40, 0x16E5F, 1}, {0x1D400, 0x1D419, 1}, {0x1D434, 0x1D44D, 1}, {0x1D468, 0x1D481, 1}, {0x1D49C, 0x1D49E, 2},
+    {0x1D49F, 0x1D49F, 1}, {0x1D4A2, 0x1D4A2, 1}, {0x1D4A5, 0x1D4A6, 1}, {0x1D4A9, 0x1D4AC, 1}, {0x1D4AE, 0x1D4B5, 1},
+    {0x1D4D0, 0x1D4E9, 1}, {0x1D504, 0x1D505, 1}, {0x1D507, 0x1D50A, 1}, {0x1D50D, 0x1D514, 1}, {0x1D516, 0x1D51C, 1},
+    {0x1D538, 0x1D539, 1}, {0x1D53B, 0x1D53E, 1}, {0x1D540, 0x1D544, 1}, {0x1D546, 0x1D546, 1}, {0x1D54A, 0x1D550, 1},
+    {0x1D56C, 0x1D585, 1}, {0x1D5A0, 0x1D5B9, 1}, {0x1D5D4, 0x1D5ED, 1}, {0x1D608, 0x1D621, 1}, {0x1D63C, 0x1D655, 1},
+    {0x1D670, 0x1D689, 1}, {0x1D6A8, 0x1D6C0, 1}, {0x1D6E2, 0x1D6FA, 1}, {0x1D71C, 0x1D734, 1}, {0x1D756, 0x1D76E, 1},
+    {0x1D790, 0x1D7A8, 1}, {0x1D7CA, 0x1D7CA, 1}, {0x1E900, 0x1E921, 1}, {0x1F130, 0x1F149, 1}, {0x1F150, 0x1F169, 1},
+    {0x1F170, 0x1F189, 1},
+};
+
+bool isUpper(char32_t c) {
+  if (c < 0x80) {
+    return c >= 'A' && c <= 'Z';
+  }
+  const Run *run = std::upper_bound(std::begin(kUpper), std::end(kUpper), c,
+                                    [](char32_t code, const Run &run) { return code < run.first; });
+  if (run == std::begin(kUpper)) {
+    return false;
+  }
+  --run;
+  return c <= run->last && (c - run->first) % run->step == 0;
+}
+
+struct Range {
+  char32_t first;
+  char32_t last;
+};
+
+/// Characters outside ASCII that are not word characters (\w in Perl: letters,
+/// marks, digits and connector punctuation), as ranges which may include
+/// unassigned code points (Unicode 14.0).
+const Range kNonWord[] = {
+    {0x80, 0xA9}, {0xAB, 0xB4}, {0xB6, 0xB9}, {0xBB, 0xBF}, {0xD7, 0xD7}, {0xF7, 0xF7}, {0x2C2, 0x2C5}, {0x2D2, 0x2DF},
+    {0x2E5, 0x2EB}, {0x2ED, 0x2ED}, {0x2EF, 0x2FF}, {0x375, 0x375}, {0x37E, 0x37E}, {0x384, 0x385}, {0x387, 0x387},
+    {0x3F6, 0x3F6}, {0x482, 0x482}, {0x55A, 0x55F}, {0x589, 0x58F}, {0x5BE, 0x5BE}, {0x5C0, 0x5C0}, {0x5C3, 0x5C3},
+    {0x5C6, 0x5C6}, {0x5F3, 0x60F}, {0x61B, 0x61F}, {0x66A, 0x66D}, {0x6D4, 0x6D4}, {0x6DD, 0x6DE}, {0x6E9, 0x6E9},
+    {0x6FD, 0x6FE}, {0x700, 0x70F}, {0x7F6, 0x7F9}, {0x7FE, 0x7FF}, {0x830, 0x83E}, {0x85E, 0x85E}, {0x888, 0x888},
+    {0x890, 0x891}, {0x8E2, 0x8E2}, {0x964, 0x965}, {0x970, 0x970}, {0x9F2, 0x9FB}, {0x9FD, 0x9FD}, {0xA76, 0xA76},
+    {0xAF0, 0xAF1}, {0xB70, 0xB70}, {0xB72, 0xB77}, {0xBF0, 0xBFA}, {0xC77, 0xC7F}, {0xC84, 0xC84}, {0xD4F, 0xD4F},
+    {0xD58, 0xD5E}, {0xD70, 0xD79}, {0xDF4, 0xDF4}, {0xE3F, 0xE3F}, {0xE4F, 0xE4F}, {0xE5A, 0xE5B}, {0xF01, 0xF17},
+    {0xF1A, 0xF1F}, {0xF2A, 0xF34}, {0xF36, 0xF36}, {0xF38, 0xF38}, {0xF3A, 0xF3D}, {0xF85, 0xF85}, {0xFBE, 0xFC5},
+    {0xFC7, 0xFDA}, {0x104A, 0x104F}, {0x109E, 0x109F}, {0x10FB, 0x10FB}, {0x1360, 0x137C}, {0x1390, 0x1399},
+    {0x1400, 0x1400}, {0x166D, 0x166E}, {0x1680, 0x1680}, {0x169B, 0x169C}, {0x16EB, 0x16ED}, {0x1735, 0x1736},
+    {0x17D4, 0x17D6}, {0x17D8, 0x17DB}, {0x17F0, 0x180A}, {0x180E, 0x180E}, {0x1940, 0x1945}, {0x19DA, 0x19FF},
+    {0x1A1E, 0x1A1F}, {0x1AA0, 0x1AA6}, {0x1AA8, 0x1AAD}, {0x1B5A, 0x1B6A}, {0x1B74, 0x1B7E}, {0x1BFC, 0x1BFF},
+    {0x1C3B, 0x1C3F}, {0x1C7E, 0x1C7F}, {0x1CC0, 0x1CC7}, {0x1CD3, 0x1CD3}, {0x1FBD, 0x1FBD}, {0x1FBF, 0x1FC1},
+    {0x1FCD, 0x1FCF}, {0x1FDD, 0x1FDF}, {0x1FED, 0x1FEF}, {0x1FFD, 0x200B}, {0x200E, 0x203E}, {0x2041, 0x2053},
+    {0x2055, 0x2070}, {0x2074, 0x207E}, {0x2080, 0x208E}, {0x20A0, 0x20C0}, {0x2100, 0x2101}, {0x2103, 0x2106},
+    {0x2108, 0x2109}, {0x2114, 0x2114}, {0x2116, 0x2118}, {0x211E, 0x2123}, {0x2125, 0x2125}, {0x2127, 0x2127},
+    {0x2129, 0x2129}, {0x212E, 0x212E}, {0x213A, 0x213B}, {0x2140, 0x2144}, {0x214A, 0x214D}, {0x214F, 0x215F},
+    {0x2189, 0x24B5}, {0x24EA, 0x2BFF}, {0x2CE5, 0x2CEA}, {0x2CF9, 0x2CFF}, {0x2D70, 0x2D70}, {0x2E00, 0x2E2E},
+    {0x2E30, 0x3004}, {0x3008, 0x3020}, {0x3030, 0x3030}, {0x3036, 0x3037}, {0x303D, 0x303F}, {0x309B, 0x309C},
+    {0x30A0, 0x30A0}, {0x30FB, 0x30FB}, {0x3190, 0x319F}, {0x31C0, 0x31E3}, {0x3200, 0x33FF}, {0x4DC0, 0x4DFF},
+    {0xA490, 0xA4C6}, {0xA4FE, 0xA4FF}, {0xA60D, 0xA60F}, {0xA673, 0xA673}, {0xA67E, 0xA67E}, {0xA6F2, 0xA716},
+    {0xA720, 0xA721}, {0xA789, 0xA78A}, {0xA828, 0xA82B}, {0xA830, 0xA839}, {0xA874, 0xA877}, {0xA8CE, 0xA8CF},
+    {0xA8F8, 0xA8FA}, {0xA8FC, 0xA8FC}, {0xA92E, 0xA92F}, {0xA95F, 0xA95F}, {0xA9C1, 0xA9CD}, {0xA9DE, 0xA9DF},
+    {0xAA5C, 0xAA5F}, {0xAA77, 0xAA79}, {0xAADE, 0xAADF}, {0xAAF0, 0xAAF1}, {0xAB5B, 0xAB5B}, {0xAB6A, 0xAB6B},
+    {0xABEB, 0xABEB}, {0xE000, 0xF8FF}, {0xFB29, 0xFB29}, {0xFBB2, 0xFBC2}, {0xFD3E, 0xFD4F}, {0xFDCF, 0xFDCF},
+    {0xFDFC, 0xFDFF}, {0xFE10, 0xFE19}, {0xFE30, 0xFE32}, {0xFE35, 0xFE4C}, {0xFE50, 0xFE6B}, {0xFEFF, 0xFF0F},
+    {0xFF1A, 0xFF20}, {0xFF3B, 0xFF3E}, {0xFF40, 0xFF40}, {0xFF5B, 0xFF65}, {0xFFE0, 0xFFFD}, {0x10100, 0x1013F},
+    {0x10175, 0x101FC}, {0x102E1, 0x102FB}, {0x10320, 0x10323}, {0x1039F, 0x1039F}, {0x103D0, 0x103D0},
+    {0x1056F, 0x1056F}, {0x10857, 0x1085F}, {0x10877, 0x1087F}, {0x108A7, 0x108AF}, {0x108FB, 0x108FF},
+    {0x10916, 0x1091F}, {0x1093F, 0x1093F}, {0x109BC, 0x109BD}, {0x109C0, 0x109FF}, {0x10A40, 0x10A58},
+    {0x10A7D, 0x10A7F}, {0x10A9D, 0x10A9F}, {0x10AC8, 0x10AC8}, {0x10AEB, 0x10AF6}, {0x10B39, 0x10B3F},
+    {0x10B58, 0x10B5F}, {0x10B78, 0x10B7F}, {0x10B99, 0x10BAF}, {0x10CFA, 0x10CFF}, {0x10E60, 0x10E7E},
+    {0x10EAD, 0x10EAD}, {0x10F1D, 0x10F26}, {0x10F51, 0x10F59}, {0x10F86, 0x10F89}, {0x10FC5, 0x10FCB},
+    {0x11047, 0x11065}, {0x110BB, 0x110C1}, {0x110CD, 0x110CD}, {0x11140, 0x11143}, {0x11174, 0x11175},
+    {0x111C5, 0x111C8}, {0x111CD, 0x111CD}, {0x111DB, 0x111DB}, {0x111DD, 0x111F4}, {0x11238, 0x1123D},
+    {0x112A9, 0x112A9}, {0x1144B, 0x1144F}, {0x1145A, 0x1145D}, {0x114C6, 0x114C6}, {0x115C1, 0x115D7},
+    {0x11641, 0x11643}, {0x11660, 0x1166C}, {0x116B9, 0x116B9}, {0x1173A, 0x1173F}, {0x1183B, 0x1183B},
+    {0x118EA, 0x118F2}, {0x11944, 0x11946}, {0x119E2, 0x119E2}, {0x11A3F, 0x11A46}, {0x11A9A, 0x11A9C},
+    {0x11A9E, 0x11AA2}, {0x11C41, 0x11C45}, {0x11C5A, 0x11C71}, {0x11EF7, 0x11EF8}, {0x11FC0, 0x11FFF},
+    {0x12470, 0x12474}, {0x12FF1, 0x12FF2}, {0x13430, 0x13438}, {0x16A6E, 0x16A6F}, {0x16AF5, 0x16AF5},
+    {0x16B37, 0x16B3F}, {0x16B44, 0x16B45}, {0x16B5B, 0x16B61}, {0x16E80, 0x16E9A}, {0x16FE2, 0x16FE2},
+    {0x1BC9C, 0x1BC9C}, {0x1BC9F, 0x1BCA3}, {0x1CF50, 0x1D164}, {0x1D16A, 0x1D16C}, {0x1D173, 0x1D17A},
+    {0x1D183, 0x1D184}, {0x1D18C, 0x1D1A9}, {0x1D1AE, 0x1D241}, {0x1D245, 0x1D378}, {0x1D6C1, 0x1D6C1},
+    {0x1D6DB, 0x1D6DB}, {0x1D6FB, 0x1D6FB}, {0x1D715, 0x1D715}, {0x1D735, 0x1D735}, {0x1D74F, 0x1D74F},
+    {0x1D76F, 0x1D76F}, {0x1D789, 0x1D789}, {0x1D7A9, 0x1D7A9}, {0x1D7C3, 0x1D7C3}, {0x1D800, 0x1D9FF},
+    {0x1DA37, 0x1DA3A}, {0x1DA6D, 0x1DA74}, {0x1DA76, 0x1DA83}, {0x1DA85, 0x1DA8B}, {0x1E14F, 0x1E14F},
+    {0x1E2FF, 0x1E2FF}, {0x1E8C7, 0x1E8CF}, {0x1E95E, 0x1ED3D}, {0x1EEF0, 0x1F12F}, {0x1F14A, 0x1F14F},
+    {0x1F16A, 0x1F16F}, {0x1F18A, 0x1FBCA}, {0xE0001, 0xE007F}, {0xF0000, 0x10FFFD},
+};
+
+/// Letters, digits and underscore, as \w in Perl.
+bool isWordCharacter(char32_t c) {
+  if (c < 0x80) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+  }
+  const Range *range = std::upper_bound(std::begin(kNonWord), std::end(kNonWord), c,
+                                        [](char32_t code, const Range &range) { return code < range.first; });
+  return range == std::begin(kNonWord) || c > (range - 1)->last;
+}
+
+bool isTerminal(char c) { return c == '.' || c == '?' || c == '!'; }
+
+/// Non-zero if any byte of word is byte.
+uint64_t hasByte(uint64_t word, unsigned char byte) {
+  const uint64_t ones = 0x0101010101010101ULL;
+  uint64_t x = word ^ (ones * byte);
+  return (x - ones) & ~x & (ones << 7);
+}
+
+/// First `.`, `?` or `!` in [p, end), or end. Looks at eight bytes at a time
+/// until a word contains one, which most words of text do not.
+const char *findTerminal(const char *p, const char *end) {
+  while (end - p >= 8) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    if (hasByte(word, '.') | hasByte(word, '?') | hasByte(word, '!')) {
+      break;
+    }
+    p += 8;
+  }
+  while (p < end && !isTerminal(*p)) {
+    p++;
+  }
+  return p;
+}
+
+/// Whether the word ending at end ends in an upper case acronym with full
+/// stops, like "U.S." (a full stop, upper case letters or hyphens, full stops).
+bool isAcronym(const char *begin, const char *end) {
+  const char *p = end;
+  while (p > begin && p[-1] == '.') {
+    p--;
+  }
+  if (p == end) {
+    return false;
+  }
+  const char *lettersEnd = p;
+  while (p > begin) {
+    const char *start;
+    char32_t c = decodeBackwards(begin, p, start);
+    if (!isUpper(c) && c != '-') {
+      break;
+    }
+    p = start;
+  }
+  return p < lettersEnd && p > begin && p[-1] == '.';
+}
+
+}  // namespace
+
+void NonbreakingPrefixes::load(const std::string &path) {
+  std::ifstream in(path);
+  ABORT_IF(!in, "Cannot read nonbreaking prefixes from {}", path);
+  const std::string numericOnly = "#NUMERIC_ONLY#";
+  std::string line;
+  while (std::getline(in, line)) {
+    std::string_view prefix(line);
+    while (!prefix.empty() && isSpace(prefix.back())) {
+      prefix.remove_suffix(1);
+    }
+    while (!prefix.empty() && isSpace(prefix.front())) {
+      prefix.remove_prefix(1);
+    }
+    if (prefix.empty() || prefix.front() == '#') {
+      continue;
+    }
+    Type type = ALWAYS;
+    size_t marker = prefix.find(numericOnly);
+    if (marker != std::string_view::npos && marker > 0 && isSpace(prefix[marker - 1])) {
+      type = NUMERIC_ONLY;
+      prefix = prefix.substr(0, marker);
+      while (!prefix.empty() && isSpace(prefix.back())) {
+        prefix.remove_suffix(1);
+      }
+    }
+    add(prefix, type);
+  }
+}
+
+void NonbreakingPrefixes::add(std::string_view prefix, Type type) {
+  if (prefix.empty()) {
+    return;
+  }
+  uint32_t node = 0;
+  for (auto byte = prefix.rbegin(); byte != prefix.rend(); ++byte) {
+    uint32_t child = next(node, *byte);
+    if (child == 0) {
+      child = static_cast<uint32_t>(nodes_.size());
+      nodes_[node].edges.push_back(Edge{*byte, child});
+      nodes_.emplace_back();
+    }
+    node = child;
+  }
+  if (nodes_[node].type != ALWAYS) {
+    nodes_[node].type = type;
+  }
+}
+
+uint32_t NonbreakingPrefixes::next(uint32_t node, char byte) const {
+  for (const Edge &edge : nodes_[node].edges) {
+    if (edge.byte == byte) {
+      return edge.node;
+    }
+  }
+  return 0;
+}
+
+NonbreakingPrefixes::Type NonbreakingPrefixes::match(const char *begin, const char *end) const {
+  uint32_t node = 0;
+  const char *p = end;
+  while (p > begin) {
+    const char *start;
+    char32_t c = decodeBackwards(begin, p, start);
+    if (!isWordCharacter(c) && c != '.' && c != '-') {
+      break;
+    }
+    for (const char *byte = p - 1; byte >= start; byte--) {
+      node = next(node, *byte);
+      if (node == 0) {
+        // The run is longer than any prefix ending like it.
+        return NONE;
+      }
+    }
+    p = start;
+  }
+  return nodes_[node].type;
+}
+
+size_t NativeSentenceSplitter::findBoundary(std::string_view paragraph) const {
+  const char *begin = paragraph.data();
+  const char *end = begin + paragraph.size();
+  for (const char *p = findTerminal(begin, end); p < end; p = findTerminal(p, end)) {
+    const char *punctuationEnd = p;
+    while (punctuationEnd < end && isTerminal(*punctuationEnd)) {
+      punctuationEnd++;
+    }
+    bool fullStop = punctuationEnd[-1] == '.';
+    bool ellipsis = fullStop && punctuationEnd - p > 1 && punctuationEnd[-2] == '.';
+    // Closing quotes or brackets may follow, after spaces too, if spaces
+    // follow them.
+    const char *closingBegin = punctuationEnd;
+    while (closingBegin < end && isSpace(*closingBegin)) {
+      closingBegin++;
+    }
+    const char *closingEnd = closingBegin;
+    for (const char *next; closingEnd < end && isClosing(decode(closingEnd, end, next));) {
+      closingEnd = next;
+    }
+    if (closingEnd == closingBegin || closingEnd == end || !isSpace(*closingEnd)) {
+      closingEnd = punctuationEnd;
+      for (const char *next; closingEnd < end && isClosing(decode(closingEnd, end, next));) {
+        closingEnd = next;
+      }
+    }
+    const char *nextWord = closingEnd;
+    while (nextWord < end && isSpace(*nextWord)) {
+      nextWord++;
+    }
+    p = punctuationEnd;
+    if (nextWord == closingEnd || nextWord == end) {
+      continue;
+    }
+
+    // The next sentence must start with an upper case letter (or a digit, for
+    // a full stop), possibly after opening quotes or brackets. Spaces may
+    // separate these from an upper case letter.
+    const char *starter = nextWord;
+    for (const char *next; starter < end && isOpening(decode(starter, end, next));) {
+      starter = next;
+    }
+    bool opened = starter > nextWord;
+    const char *letter = starter;
+    while (opened && letter < end && isSpace(*letter)) {
+      letter++;
+    }
+    if (letter == end) {
+      continue;
+    }
+    const char *next;
+    char32_t first = decode(letter, end, next);
+    bool upper = isUpper(first);
+    bool digit = letter == starter && first >= '0' && first <= '9';
+    bool closed = closingEnd > punctuationEnd;
+
+    // Question and exclamation marks, ellipses, and punctuation followed by
+    // closing or preceded by opening quotes end a sentence before upper case.
+    if (upper && (!fullStop || ellipsis || closed || opened)) {
+      return closingEnd - begin;
+    }
+    if (!fullStop || closed || (!upper && !digit)) {
+      continue;
+    }
+
+    // Full stop after a word: not a boundary after nonbreaking prefixes and
+    // acronyms. Quotes right before the full stop disable prefixes.
+    const char *dot = punctuationEnd - 1;
+    const char *prefixEnd = dot;
+    while (prefixEnd > begin) {
+      const char *start;
+      if (!isClosing(decodeBackwards(begin, prefixEnd, start))) {
+        break;
+      }
+      prefixEnd = start;
+    }
+    bool quoted = prefixEnd < dot;
+    NonbreakingPrefixes::Type type = prefixes_.match(begin, prefixEnd);
+    if (type == NonbreakingPrefixes::ALWAYS && !quoted) {
+      continue;
+    }
+    if (isAcronym(begin, punctuationEnd)) {
+      continue;
+    }
+    if (type == NonbreakingPrefixes::NUMERIC_ONLY && !quoted && digit && !opened) {
+      continue;
+    }
+    return closingEnd - begin;
+  }
+  return paragraph.size();
+}
+
+NativeSentenceStream::NativeSentenceStream(std::string_view text, const NativeSentenceSplitter &splitter,
+                                           SplitMode mode)
+    : text_(text), splitter_(splitter), mode_(mode) {}
+
+bool NativeSentenceStream::operator>>(std::string_view &sentence) {
+  while (position_ < paragraphEnd_ && isSpace(text_[position_])) {
+    position_++;
+  }
+  if (position_ == paragraphEnd_ && !nextParagraph()) {
+    return false;
+  }
+
+  std::string_view rest = text_.substr(position_, paragraphEnd_ - position_);
+  size_t length = (mode_ == ONE_SENTENCE_PER_LINE) ? rest.size() : splitter_.findBoundary(rest);
+  sentence = rest.substr(0, length);
+  while (isSpace(sentence.back())) {
+    sentence.remove_suffix(1);
+  }
+  position_ += length;
+  return true;
+}
+
+bool NativeSentenceStream::nextParagraph() {
+  position_ = paragraphEnd_;
+  while (position_ < text_.size() && isSpace(text_[position_])) {
+    position_++;
+  }
+  if (position_ == text_.size()) {
+    return false;
+  }
+
+  // Paragraphs start at a non-space, so they are never empty.
+  const char *begin = text_.data();
+  const char *end = begin + text_.size();
+  const char *lineEnd = begin + position_;
+  while ((lineEnd = static_cast<const char *>(std::memchr(lineEnd, '\n', end - lineEnd))) != nullptr) {
+    if (mode_ != WRAPPED_TEXT) {
+      break;
+    }
+    // In wrapped text only an empty line (or one of whitespace) ends the
+    // paragraph.
+    const char *p = lineEnd + 1;
+    while (p < end && *p != '\n' && isSpace(*p)) {
+      p++;
+    }
+    if (p < end && *p == '\n') {
+      break;
+    }
+    lineEnd++;
+  }
+  paragraphEnd_ = (lineEnd == nullptr) ? text_.size() : lineEnd - begin;
+  return true;
+}
+
+}  // namespace bergamot
+}  // namespace marian
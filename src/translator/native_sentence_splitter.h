@@ -0,0 +1,109 @@
+#ifndef SRC_BERGAMOT_NATIVE_SENTENCE_SPLITTER_H_
+#define SRC_BERGAMOT_NATIVE_SENTENCE_SPLITTER_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace marian {
+namespace bergamot {
+
+/// How text is laid out into sentences and paragraphs, as ssplit-mode.
+enum SplitMode {
+  /// Every line is a sentence.
+  ONE_SENTENCE_PER_LINE,
+
+  /// Every line is a paragraph, split into sentences.
+  ONE_PARAGRAPH_PER_LINE,
+
+  /// Paragraphs are separated by empty lines and split into sentences. Other
+  /// line breaks are whitespace.
+  WRAPPED_TEXT
+};
+
+/// Nonbreaking prefixes (Moses format: one prefix per line, `#` comments,
+/// `#NUMERIC_ONLY#` marking prefixes that only hold before a number), compiled
+/// into a trie of the reversed prefixes. Splitting walks it backwards from a
+/// full stop over the token before it, so a prefix is recognised in the same
+/// pass that finds the token's start, without copying the token.
+class NonbreakingPrefixes {
+ public:
+  enum Type : uint8_t { NONE, ALWAYS, NUMERIC_ONLY };
+
+  /// Loads prefixes from file at path, aborting if it cannot be read.
+  void load(const std::string &path);
+
+  /// Adds a prefix. ALWAYS takes precedence if a prefix is added twice.
+  void add(std::string_view prefix, Type type);
+
+  /// Type of the prefix ending right before end, which is the longest run of
+  /// word characters, dots and hyphens ending there and starting at or after
+  /// begin. NONE if the run is empty or not a prefix.
+  Type match(const char *begin, const char *end) const;
+
+ private:
+  struct Edge {
+    char byte;
+    uint32_t node;
+  };
+  struct Node {
+    std::vector<Edge> edges;
+    Type type{NONE};
+  };
+
+  /// Child of node on byte, 0 (the root, never a child) if none.
+  uint32_t next(uint32_t node, char byte) const;
+
+  std::vector<Node> nodes_{1};
+};
+
+class NativeSentenceSplitter;
+
+/// Sentences of a text, one at a time. Sentences are views into the text,
+/// without surrounding whitespace. The text must outlive the stream.
+class NativeSentenceStream {
+ public:
+  NativeSentenceStream(std::string_view text, const NativeSentenceSplitter &splitter, SplitMode mode);
+
+  /// Sets sentence to the next sentence, returns false at the end of text.
+  bool operator>>(std::string_view &sentence);
+
+ private:
+  /// Moves paragraph_ to the next paragraph (a line in the line-based modes)
+  /// after position_. Returns false if there is none.
+  bool nextParagraph();
+
+  std::string_view text_;
+  const NativeSentenceSplitter &splitter_;
+  SplitMode mode_;
+  size_t position_{0};
+  size_t paragraphEnd_{0};
+};
+
+/// Sentence splitter following the rules of the Moses splitter that ssplit
+/// implements, in a single forward scan instead of regular expressions. Only
+/// `.`, `?` and `!` can end a sentence, so the scan skips to those a machine
+/// word at a time and looks at the surrounding bytes only there.
+///
+/// Character classes (upper case, word characters, initial and final
+/// punctuation) are those of the Perl regular expressions of the Moses
+/// splitter, as of Unicode 14.0.
+class NativeSentenceSplitter {
+ public:
+  void load(const std::string &prefixFile) { prefixes_.load(prefixFile); }
+
+  NonbreakingPrefixes &prefixes() { return prefixes_; }
+
+  /// Offset in paragraph past the end of its first sentence (after any closing
+  /// quotes or brackets), or paragraph.size() if the paragraph is one sentence.
+  size_t findBoundary(std::string_view paragraph) const;
+
+ private:
+  NonbreakingPrefixes prefixes_;
+};
+
+}  // namespace bergamot
+}  // namespace marian
+
+#endif  // SRC_BERGAMOT_NATIVE_SENTENCE_SPLITTER_H_
@@ -17,12 +17,76 @@ inline marian::ConfigParser createConfigParser() {
 
   cp.addOption<std::string>("--ssplit-mode", "Server Options", "[paragraph, sentence, wrapped_text]", "paragraph");
 
+  cp.addOption<std::string>("--ssplit-backend", "Bergamot Options",
+                            "Sentence splitter implementation: [ssplit, native]. native applies the rules of ssplit "
+                            "in a single scan without regular expressions.",
+                            "ssplit");
+
   cp.addOption<int>("--max-length-break", "Bergamot Options",
                     "Maximum input tokens to be processed in a single sentence.", 128);
 
+  cp.addOption<std::string>("--length-break-strategy", "Bergamot Options",
+                            "How sentences longer than max-length-break are broken: [fixed, boundary]. fixed cuts "
+                            "every max-length-break tokens, boundary cuts into pieces of even length at nearby "
+                            "punctuation or word boundaries.",
+                            "fixed");
+
+  cp.addOption<int>("--text-processing-threads", "Bergamot Options",
+                    "Threads to split and tokenize large inputs on. Inputs are cut at paragraph boundaries "
+                    "into chunks processed in parallel.",
+                    1);
+
+  cp.addOption<std::vector<std::string>>("--skip-translation", "Bergamot Options",
+                                         "Kinds of sentences copied to the target untranslated, without reaching the "
+                                         "model: [numbers, urls, emails, identifiers].",
+                                         {});
+
+  cp.addOption<int>("--encoding-cache-size", "Bergamot Options",
+                    "Number of sentences whose SentencePiece encoding is cached for reuse. 0 disables the cache.", 0);
+
+  cp.addOption<int>("--stream-chunk-bytes", "Bergamot Options",
+                    "Translate input in chunks of about this many bytes, cut at paragraph boundaries, instead of "
+                    "reading it whole. 0 reads the whole input (default).",
+                    0);
+
+  cp.addOption<int>("--stream-max-requests", "Bergamot Options",
+                    "Maximum number of chunks queued for translation at once when streaming.", 4);
+
   cp.addOption<bool>("--check-bytearray", "Bergamot Options",
                      "Flag holds whether to check the content of the bytearray (true by default)", true);
 
+  cp.addOption<std::string>("--model-checksum", "Bergamot Options",
+                            "Expected checksum (hex) of the model bytearray, verified when --check-bytearray is set. "
+                            "The computed checksum is logged if none is given.",
+                            "");
+
+  cp.addOption<std::string>("--bytearray-shared-memory", "Bergamot Options",
+                            "Name for shared memory segments to load model and shortlist bytearrays into. Processes "
+                            "using the same name share one copy (POSIX only).",
+                            "");
+
+  cp.addOption<int>("--completion-threads", "Bergamot Options",
+                    "Threads building responses from finished translations, so that workers go on to the next batch "
+                    "right away. 0 builds them on the worker finishing the last sentence.",
+                    0);
+
+  cp.addOption<bool>("--offline-batching", "Bergamot Options",
+                     "Split and tokenize all inputs of a blocking multi-input translation (as in "
+                     "bergamot-translator-app) before translating any, so that batches are cut from all sentences "
+                     "sorted by length. Packs batches best, for throughput on offline corpora.",
+                     false);
+
+  cp.addOption<int>("--hand-off-tokens", "Bergamot Options",
+                    "Hand requests of at most this many (padded) tokens, such as a sentence typed in a UI, straight "
+                    "to a waiting worker, skipping the batching queue to cut latency. Requests queue as usual while "
+                    "all workers are busy. 0 disables.",
+                    0);
+
+  cp.addOption<bool>("--lazy-workers", "Bergamot Options",
+                     "Start workers and initialize their graphs only when queued work needs them, instead of all "
+                     "up front.",
+                     false);
+
   return cp;
 }
 
@@ -0,0 +1,124 @@
+#include "passthrough_classifier.h"
+
+#include <cctype>
+
+#include "common/logging.h"
+
+namespace marian {
+namespace bergamot {
+
+namespace {
+
+bool isLetter(char c) { return std::isalpha(static_cast<unsigned char>(c)); }
+
+bool isDigit(char c) { return std::isdigit(static_cast<unsigned char>(c)); }
+
+bool isASCII(char c) { return static_cast<unsigned char>(c) < 0x80; }
+
+bool startsWith(string_view text, string_view prefix) {
+  return text.size() >= prefix.size() && text.substr(0, prefix.size()) == prefix;
+}
+
+bool isNumber(string_view sentence) {
+  bool digit = false;
+  for (char c : sentence) {
+    if (!isASCII(c) || isLetter(c)) {
+      return false;
+    }
+    digit |= isDigit(c);
+  }
+  return digit;
+}
+
+bool isURL(string_view word) {
+  static const std::vector<string_view> prefixes = {"http://", "https://", "ftp://", "file://", "www."};
+  for (string_view prefix : prefixes) {
+    if (startsWith(word, prefix) && word.size() > prefix.size()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool isEmail(string_view word) {
+  size_t at = word.find('@');
+  if (at == 0 || at == string_view::npos || word.find('@', at + 1) != string_view::npos) {
+    return false;
+  }
+  size_t dot = word.rfind('.');
+  return dot != string_view::npos && dot > at + 1 && dot + 1 < word.size();
+}
+
+bool isIdentifier(string_view word) {
+  bool code = false;
+  for (size_t i = 0; i < word.size(); i++) {
+    char c = word[i];
+    if (!isASCII(c) || !(std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == ':' || c == '.' ||
+                         c == '(' || c == ')' || c == '-' || c == '/')) {
+      return false;
+    }
+    bool camelCase = i > 0 && std::islower(static_cast<unsigned char>(word[i - 1])) &&
+                     std::isupper(static_cast<unsigned char>(c));
+    code |= camelCase || (c == '_' && i > 0) || (c == ':' && i > 0 && word[i - 1] == ':') ||
+            (c == ')' && i > 0 && word[i - 1] == '(');
+  }
+  return code && isLetter(word.front() == '_' ? word.back() : word.front());
+}
+
+}  // namespace
+
+PassthroughClassifier::PassthroughClassifier(Ptr<Options> options) {
+  for (const std::string &kind : options->get<std::vector<std::string>>("skip-translation", {})) {
+    if (kind == "numbers") {
+      numbers_ = true;
+    } else if (kind == "urls") {
+      urls_ = true;
+    } else if (kind == "emails") {
+      emails_ = true;
+    } else if (kind == "identifiers") {
+      identifiers_ = true;
+    } else {
+      ABORT("Unknown skip-translation {}, expected numbers, urls, emails or identifiers", kind);
+    }
+  }
+}
+
+std::vector<bool> PassthroughClassifier::classify(const AnnotatedText &source) {
+  std::vector<bool> passthrough;
+  if (!enabled()) {
+    return passthrough;
+  }
+  passthrough.reserve(source.numSentences());
+  size_t count = 0;
+  for (size_t sentenceIdx = 0; sentenceIdx < source.numSentences(); sentenceIdx++) {
+    passthrough.push_back(this->passthrough(source.sentence(sentenceIdx)));
+    count += passthrough.back() ? 1 : 0;
+  }
+  sentences_ += source.numSentences();
+  passthrough_ += count;
+  return passthrough;
+}
+
+bool PassthroughClassifier::passthrough(string_view sentence) const {
+  if (numbers_ && isNumber(sentence)) {
+    return true;
+  }
+
+  // The remaining kinds are single words. Trailing punctuation, as in the
+  // sentence "a@b.org." or "https://example.com!", is not part of the word.
+  if (sentence.empty() || sentence.find_first_of(" \t\n\r") != string_view::npos) {
+    return false;
+  }
+  string_view word = sentence;
+  while (!word.empty() && (word.back() == '.' || word.back() == ',' || word.back() == ';' || word.back() == '!' ||
+                           word.back() == '?')) {
+    word.remove_suffix(1);
+  }
+  if (word.empty()) {
+    return false;
+  }
+  return (urls_ && isURL(word)) || (emails_ && isEmail(word)) || (identifiers_ && isIdentifier(word));
+}
+
+}  // namespace bergamot
+}  // namespace marian
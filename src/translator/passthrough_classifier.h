@@ -0,0 +1,62 @@
+#ifndef SRC_BERGAMOT_PASSTHROUGH_CLASSIFIER_H_
+#define SRC_BERGAMOT_PASSTHROUGH_CLASSIFIER_H_
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "annotation.h"
+#include "common/options.h"
+#include "definitions.h"
+
+namespace marian {
+namespace bergamot {
+
+/// PassthroughClassifier picks out sentences not worth translating, which are
+/// passed through to the target as they are instead (with identity alignment
+/// and zero word scores), without being batched or decoded.
+///
+/// The kinds of sentences passed through are chosen with --skip-translation:
+///  - numbers: digits with punctuation and symbols (ASCII) but no letters, such
+///    as amounts, dates, phone numbers or numbered bullet markers.
+///  - urls: a single word starting with a URL scheme or "www.".
+///  - emails: a single word of the form local@domain.tld.
+///  - identifiers: a single ASCII word that looks like code: snake_case,
+///    camelCase, scoped (a::b) or called (f()).
+///
+/// Safe for concurrent use.
+class PassthroughClassifier {
+ public:
+  /// Counters reported by stats().
+  struct Stats {
+    size_t sentences{0};    ///< Sentences classified.
+    size_t passthrough{0};  ///< Sentences passed through.
+  };
+
+  explicit PassthroughClassifier(Ptr<Options> options);
+
+  /// Whether any kind of sentence is passed through.
+  bool enabled() const { return numbers_ || urls_ || emails_ || identifiers_; }
+
+  /// Returns for each sentence of source whether it is passed through, or an
+  /// empty vector if the classifier is not enabled.
+  std::vector<bool> classify(const AnnotatedText &source);
+
+  Stats stats() const { return Stats{sentences_.load(), passthrough_.load()}; }
+
+ private:
+  bool passthrough(string_view sentence) const;
+
+  bool numbers_{false};
+  bool urls_{false};
+  bool emails_{false};
+  bool identifiers_{false};
+
+  std::atomic<size_t> sentences_{0};
+  std::atomic<size_t> passthrough_{0};
+};
+
+}  // namespace bergamot
+}  // namespace marian
+
+#endif  // SRC_BERGAMOT_PASSTHROUGH_CLASSIFIER_H_
@@ -0,0 +1,133 @@
+#include "pivot_response_builder.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+namespace marian {
+namespace bergamot {
+
+PivotResponseBuilder::PivotResponseBuilder(AnnotatedText &&source, const ResponseOptions &responseOptions,
+                                           CallbackType callback)
+    : source_(std::move(source)),
+      responseOptions_(responseOptions),
+      callback_(std::move(callback)),
+      firstHops_(source_.numSentences()),
+      secondHops_(source_.numSentences()),
+      pending_(source_.numSentences()) {
+  if (source_.numSentences() == 0) {
+    build();
+  }
+}
+
+void PivotResponseBuilder::add(size_t sentenceIdx, Response &&firstHop, Response &&secondHop) {
+  firstHops_[sentenceIdx] = std::move(firstHop);
+  secondHops_[sentenceIdx] = std::move(secondHop);
+  if (--pending_ == 0) {
+    build();
+  }
+}
+
+void PivotResponseBuilder::build() {
+  Response response;
+  response.source = std::move(source_);
+  response.target.text.reserve(response.source.view().size());
+
+  size_t numSentences = response.source.numSentences();
+  for (size_t sentenceIdx = 0; sentenceIdx < numSentences; sentenceIdx++) {
+    buildTargetSentence(sentenceIdx, secondHops_[sentenceIdx], response);
+    if (responseOptions_.qualityScores) {
+      response.qualityScores.push_back(composeQualityScores(firstHops_[sentenceIdx], secondHops_[sentenceIdx]));
+    }
+    if (responseOptions_.alignment) {
+      response.alignments.push_back(composeAlignments(firstHops_[sentenceIdx], secondHops_[sentenceIdx]));
+    }
+  }
+  if (responseOptions_.concatStrategy == ConcatStrategy::FAITHFUL && numSentences > 0) {
+    response.target.appendEndingWhitespace(response.source.gap(numSentences));
+  }
+
+  callback_(std::move(response));
+}
+
+void PivotResponseBuilder::buildTargetSentence(size_t sentenceIdx, const Response &secondHop, Response &response) {
+  // Tokens must be contiguous, so the gap before each following sentence of
+  // the second hop is made part of its first token.
+  const AnnotatedText &target = secondHop.target;
+  std::vector<string_view> tokens;
+  const char *end = nullptr;
+  for (size_t idx = 0; idx < target.numSentences(); idx++) {
+    for (size_t wordIdx = 0; wordIdx < target.numWords(idx); wordIdx++) {
+      string_view word = target.word(idx, wordIdx);
+      const char *begin = (end == nullptr) ? word.data() : end;
+      end = word.data() + word.size();
+      tokens.emplace_back(begin, end - begin);
+    }
+  }
+
+  switch (responseOptions_.concatStrategy) {
+    case ConcatStrategy::FAITHFUL:
+      response.target.appendSentence(response.source.gap(sentenceIdx), tokens.begin(), tokens.end());
+      break;
+    case ConcatStrategy::SPACE:
+      response.target.appendSentence((sentenceIdx == 0) ? "" : " ", tokens.begin(), tokens.end());
+      break;
+    default:
+      ABORT("Unknown concat-strategy");
+  }
+}
+
+Alignment PivotResponseBuilder::composeAlignments(const Response &firstHop, const Response &secondHop) {
+  // The first hop's target and the second hop's source are the same pivot
+  // text, tokenized by either model's vocabulary, so tokens are matched by
+  // overlapping byte ranges. Points on end-of-sentence tokens (indices past the
+  // annotated words) have no text to match and are skipped; on the target side
+  // of the second hop, offsetting them would land on the next sentence.
+  std::map<std::pair<size_t, size_t>, float> composed;
+  size_t targetOffset = 0;
+  for (size_t idx = 0; idx < secondHop.source.numSentences(); idx++) {
+    for (const Point &second : secondHop.alignments[idx]) {
+      if (second.src >= secondHop.source.numWords(idx) || second.tgt >= secondHop.target.numWords(idx)) {
+        continue;
+      }
+      ByteRange secondPivot = secondHop.source.wordAsByteRange(idx, second.src);
+      for (const Point &first : firstHop.alignments[0]) {
+        if (first.tgt >= firstHop.target.numWords(0)) {
+          continue;
+        }
+        ByteRange firstPivot = firstHop.target.wordAsByteRange(0, first.tgt);
+        if (firstPivot.begin < secondPivot.end && secondPivot.begin < firstPivot.end) {
+          float &prob = composed[{first.src, targetOffset + second.tgt}];
+          prob = std::max(prob, first.prob * second.prob);
+        }
+      }
+    }
+    targetOffset += secondHop.target.numWords(idx);
+  }
+
+  Alignment alignment;
+  alignment.reserve(composed.size());
+  for (auto &point : composed) {
+    alignment.push_back(
+        Point{static_cast<WordIndex>(point.first.first), static_cast<WordIndex>(point.first.second), point.second});
+  }
+  return alignment;
+}
+
+Quality PivotResponseBuilder::composeQualityScores(const Response &firstHop, const Response &secondHop) {
+  Quality quality{firstHop.qualityScores[0].sequence, {}};
+  if (secondHop.qualityScores.empty()) {
+    return quality;
+  }
+
+  float sequence = 0;
+  for (const Quality &secondQuality : secondHop.qualityScores) {
+    sequence += secondQuality.sequence;
+    quality.word.insert(quality.word.end(), secondQuality.word.begin(), secondQuality.word.end());
+  }
+  quality.sequence += sequence / secondHop.qualityScores.size();
+  return quality;
+}
+
+}  // namespace bergamot
+}  // namespace marian
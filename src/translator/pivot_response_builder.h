@@ -0,0 +1,69 @@
+#ifndef SRC_BERGAMOT_PIVOT_RESPONSE_BUILDER_H_
+#define SRC_BERGAMOT_PIVOT_RESPONSE_BUILDER_H_
+
+#include <atomic>
+#include <vector>
+
+#include "annotation.h"
+#include "response.h"
+#include "response_builder.h"
+#include "response_options.h"
+
+namespace marian {
+namespace bergamot {
+
+/// PivotResponseBuilder builds the Response of a text translated through a
+/// pivot language, from the Responses of its sentences on either hop.
+///
+/// Each sentence of source is translated on its own from source to pivot
+/// language (first hop), and the text of that translation from pivot to target
+/// language (second hop). The first hop of a sentence is a single sentence,
+/// the second hop may have been split into several; they are joined into the
+/// one target sentence corresponding to the source sentence.
+///
+/// Alignments of both hops are composed through the pivot text: a source token
+/// is aligned to a target token if it is aligned to a pivot token of the first
+/// hop overlapping a pivot token of the second hop aligned to the target token,
+/// with probability the product of both. Word quality scores are those of the
+/// second hop. The sentence score is the first hop's plus the average of those
+/// of the sentences the second hop was split into.
+class PivotResponseBuilder {
+ public:
+  /// @param [in] source: the text to translate, processed into sentences.
+  /// @param [in] responseOptions: as for ResponseBuilder. Both hops are
+  /// expected to be built with alignments and quality scores as requested
+  /// here, and the FAITHFUL concat strategy.
+  /// @param [in] callback: called with the Response once all sentences are
+  /// added. Called immediately if source has no sentences.
+  PivotResponseBuilder(AnnotatedText &&source, const ResponseOptions &responseOptions, CallbackType callback);
+
+  /// Adds the translations of the sentence of source corresponding to
+  /// sentenceIdx on both hops. Called concurrently from workers as second hops
+  /// complete; the Response is built by the call adding the last sentence.
+  void add(size_t sentenceIdx, Response &&firstHop, Response &&secondHop);
+
+ private:
+  void build();
+
+  /// Joins the sentences of the second hop into one target sentence.
+  void buildTargetSentence(size_t sentenceIdx, const Response &secondHop, Response &response);
+
+  Alignment composeAlignments(const Response &firstHop, const Response &secondHop);
+
+  Quality composeQualityScores(const Response &firstHop, const Response &secondHop);
+
+  AnnotatedText source_;
+  ResponseOptions responseOptions_;
+  CallbackType callback_;
+
+  std::vector<Response> firstHops_;
+  std::vector<Response> secondHops_;
+
+  /// Sentences yet to be added.
+  std::atomic<size_t> pending_;
+};
+
+}  // namespace bergamot
+}  // namespace marian
+
+#endif  // SRC_BERGAMOT_PIVOT_RESPONSE_BUILDER_H_
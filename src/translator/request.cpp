@@ -11,20 +11,34 @@ namespace marian {
 namespace bergamot {
 
 // -----------------------------------------------------------------
-Request::Request(size_t Id, Segments &&segments, ResponseBuilder &&responseBuilder)
+Request::Request(size_t Id, Segments &&segments, ResponseBuilder &&responseBuilder,
+                 Histories &&cachedHistories,
+                 std::function<void(const Histories &)> onComplete, std::vector<bool> &&passthrough)
     : Id_(Id),
       segments_(std::move(segments)),
+      histories_(std::move(cachedHistories)),
+      onComplete_(std::move(onComplete)),
       responseBuilder_(std::move(responseBuilder))
 
 {
-  counter_ = segments_.size();
-  histories_.resize(segments_.size(), nullptr);
-
-  // If there are no segments_, we are never able to trigger the responseBuilder
-  // calls from a different thread. However, in this case we want an empty valid
-  // response.
-  if (segments_.size() == 0) {
-    responseBuilder_(std::move(histories_));
+  if (histories_.empty()) {
+    histories_.resize(segments_.size(), nullptr);
+  }
+  ABORT_IF(histories_.size() != segments_.size(), "Mismatch in segments and cached histories");
+  ABORT_IF(!passthrough.empty() && passthrough.size() != segments_.size(), "Mismatch in segments and passthrough");
+
+  for (size_t index = 0; index < histories_.size(); index++) {
+    if (histories_[index] == nullptr && (passthrough.empty() || !passthrough[index])) {
+      pending_.push_back(index);
+    }
+  }
+  counter_ = pending_.size();
+
+  // If there are no segments_ to translate, we are never able to trigger the
+  // responseBuilder calls from a different thread. However, in this case we
+  // want a valid response (empty, or from cached histories and passthrough).
+  if (pending_.empty()) {
+    complete();
   }
 }
 
@@ -42,8 +56,29 @@ void Request::processHistory(size_t index, Ptr<History> history) {
   // In case this is last request in, completeRequest is called, which sets the
   // value of the promise.
   if (--counter_ == 0) {
-    responseBuilder_(std::move(histories_));
+    complete();
+  }
+}
+
+void Request::complete() {
+  if (completionExecutor_ != nullptr) {
+    // The Request may be gone by the time the task runs, so the task takes
+    // what completing needs, and holds owner_ for the vocabs responseBuilder
+    // decodes with.
+    completionExecutor_->submit([histories = std::move(histories_), onComplete = std::move(onComplete_),
+                                 responseBuilder = std::move(responseBuilder_), owner = owner_]() mutable {
+      if (onComplete) {
+        onComplete(histories);
+      }
+      responseBuilder(std::move(histories));
+    });
+    return;
+  }
+
+  if (onComplete_) {
+    onComplete_(histories_);
   }
+  responseBuilder_(std::move(histories_));
 }
 
 bool Request::operator<(const Request &b) const {
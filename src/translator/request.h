@@ -2,11 +2,14 @@
 #define SRC_BERGAMOT_REQUEST_H_
 
 #include <cassert>
+#include <functional>
 #include <future>
+#include <memory>
 #include <vector>
 
 #include "annotation.h"
 #include "common/logging.h"
+#include "completion_executor.h"
 #include "data/types.h"
 #include "definitions.h"
 #include "response.h"
@@ -46,7 +49,19 @@ class Request {
   /// @param [in] responseBuilder: Callback function (of ResponseBuilder type)
   /// to be triggered upon the completion of translation of all units in a
   /// Request.
-  Request(size_t Id, Segments &&segments, ResponseBuilder &&responseBuilder);
+  /// @param [in] cachedHistories: Histories of segments already translated
+  /// earlier (see DocumentSession), nullptr for segments to be translated.
+  /// Either empty or one entry per segment. Optional.
+  /// @param [in] onComplete: Called with the histories of all segments once
+  /// complete, before responseBuilder. Optional.
+  /// @param [in] passthrough: Segments not to be translated (see
+  /// PassthroughClassifier), which are left with a nullptr history that
+  /// responseBuilder copies the source for. Either empty or one entry per
+  /// segment. Optional.
+  Request(size_t Id, Segments &&segments, ResponseBuilder &&responseBuilder,
+          Histories &&cachedHistories = {},
+          std::function<void(const Histories &)> onComplete = nullptr,
+          std::vector<bool> &&passthrough = {});
 
   /// Obtain the count of tokens in the segment correponding to index. Used to
   /// insert sentence from multiple requests into the corresponding size bucket.
@@ -55,6 +70,10 @@ class Request {
   /// Obtain number of segments in a request.
   size_t numSegments() const;
 
+  /// Indices of the segments that are to be translated, i.e. that have no
+  /// cached history and are not passed through.
+  const std::vector<size_t> &pendingSegments() const { return pending_; }
+
   /// Obtains segment corresponding to index  to create a batch of segments
   /// among several requests.
   Segment getSegment(size_t index) const;
@@ -67,7 +86,23 @@ class Request {
   /// compiled from requests.
   void processHistory(size_t index, Ptr<History> history);
 
+  /// Completes the Request on executor once all sentences are translated,
+  /// rather than on the worker translating the last one. To be set before the
+  /// Request is queued; executor must outlive the Request's translation.
+  /// owner holds what responseBuilder refers to (the TranslationModel, whose
+  /// vocabs decode the histories), and is kept until the completion has run:
+  /// the model can otherwise be released, e.g. after Service::reload(), while
+  /// the completion is still queued.
+  void setCompletionExecutor(CompletionExecutor *executor, std::shared_ptr<const void> owner) {
+    completionExecutor_ = executor;
+    owner_ = std::move(owner);
+  }
+
  private:
+  /// Hands the histories to onComplete_ and responseBuilder_, on
+  /// completionExecutor_ if set.
+  void complete();
+
   size_t Id_;
 
   /// Multiple translation-workers can concurrently access the same Request. The
@@ -83,9 +118,19 @@ class Request {
   /// segment in the corresponding index.
   std::vector<Ptr<History>> histories_;
 
+  /// Indices of segments without a cached history that are not passed
+  /// through. Not modified after
+  /// construction, so it can be read while workers fill histories_.
+  std::vector<size_t> pending_;
+
+  std::function<void(const Histories &)> onComplete_;
+
   /// Constructing Response requires the vocabs_ used to generate Request.
   /// std::vector<Ptr<Vocab const>> *vocabs_;
   ResponseBuilder responseBuilder_;
+
+  CompletionExecutor *completionExecutor_{nullptr};
+  std::shared_ptr<const void> owner_;
 };
 
 /// A RequestSentence provides a view to a sentence within a Request. Existence
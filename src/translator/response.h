@@ -2,6 +2,7 @@
 #define SRC_BERGAMOT_RESPONSE_H_
 
 #include <cassert>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -14,16 +15,22 @@
 namespace marian {
 namespace bergamot {
 
+/// Index of a (sub-)word within a sentence, as used in alignments. Sentences
+/// are broken at max-length-break tokens, so 16 bits are plenty, and keep a
+/// Point at 8 bytes.
+typedef uint16_t WordIndex;
+
 /// Alignment is stored as a sparse matrix, this pretty much aligns with marian
 /// internals but is brought here to maintain translator
 /// agnosticism/independence.
 struct Point {
-  size_t src;  ///< Index pointing to source ByteRange
-  size_t tgt;  ///< Index pointing to target ByteRange
-  float prob;  ///< Score between [0, 1] on indicating degree of alignment.
+  WordIndex src;  ///< Index pointing to source ByteRange
+  WordIndex tgt;  ///< Index pointing to target ByteRange
+  float prob;     ///< Score between [0, 1] on indicating degree of alignment.
 };
 
-/// Alignment is a sparse matrix, where Points represent entries with values.
+/// Alignment is a sparse matrix, where Points represent entries with values,
+/// ordered by source and then target index.
 typedef std::vector<Point> Alignment;
 
 /// -loglikelhoods of the sequence components as proxy to quality.
@@ -65,7 +72,10 @@ struct Response {
   /// to (sub-)words accessible through Annotation.
   std::vector<Alignment> alignments;
 
-  const std::string &getOriginalText() const { return source.text; }
+  std::string getOriginalText() const {
+    string_view original = source.view();
+    return std::string(original.data(), original.size());
+  }
 
   const std::string &getTranslatedText() const { return target.text; }
 };
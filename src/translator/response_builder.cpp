@@ -1,97 +1,182 @@
 #include "response_builder.h"
 
+#include <limits>
+
 #include "response_options.h"
 
 namespace marian {
 namespace bergamot {
 
-void ResponseBuilder::buildQualityScores(Histories &histories, Response &response) {
-  std::vector<Quality> qualityScores;
-  for (auto &history : histories) {
-    // TODO(jerin): Change hardcode of nBest = 1
-    NBestList onebest = history->nBest(1);
+namespace {
+
+/// Converts soft, a row of probabilities over source words per target word,
+/// into the sparse alignment, ordered by source then target word. Keeps each
+/// target word's most aligned source word if argmax, else all above
+/// threshold. Same as data::ConvertSoftAlignToHardAlign, but without copying
+/// the matrix or going through marian's WordAlignment.
+void hardAlign(const data::SoftAlignment &soft, float threshold, bool argmax, Alignment &alignment) {
+  size_t numTarget = soft.size();
+  size_t numSource = soft.empty() ? 0 : soft.front().size();
+  ABORT_IF(std::max(numTarget, numSource) > std::numeric_limits<WordIndex>::max(),
+           "Sentence too long to align, use a lower max-length-break");
+
+  // Points are found by target word, then bucketed by source word, which is
+  // linear rather than sorting.
+  Alignment byTarget;
+  std::vector<size_t> sourceBegin(numSource + 1, 0);
+  if (argmax || threshold == 1.0f) {
+    byTarget.reserve(numTarget);
+    for (size_t t = 0; t < numTarget; t++) {
+      const float *row = soft[t].data();
+      size_t best = 0;
+      for (size_t s = 1; s < numSource; s++) {
+        best = row[s] > row[best] ? s : best;
+      }
+      if (numSource > 0) {
+        byTarget.push_back(Point{static_cast<WordIndex>(best), static_cast<WordIndex>(t), row[best]});
+        sourceBegin[best + 1]++;
+      }
+    }
+  } else {
+    for (size_t t = 0; t < numTarget; t++) {
+      const float *row = soft[t].data();
+      for (size_t s = 0; s < numSource; s++) {
+        if (row[s] > threshold) {
+          byTarget.push_back(Point{static_cast<WordIndex>(s), static_cast<WordIndex>(t), row[s]});
+          sourceBegin[s + 1]++;
+        }
+      }
+    }
+  }
+
+  for (size_t s = 0; s < numSource; s++) {
+    sourceBegin[s + 1] += sourceBegin[s];
+  }
+  alignment.resize(byTarget.size());
+  for (const Point &point : byTarget) {
+    alignment[sourceBegin[point.src]++] = point;
+  }
+}
+
+}  // namespace
+
+void ResponseBuilder::operator()(Histories &&histories) {
+  ABORT_IF(source_.numSentences() != histories.size(), "Mismatch in source and translated sentences");
+  Response response;
+
+  // Move source_ into response.
+  response.source = std::move(source_);
+
+  // Reserving length at least as much as source_ seems like a reasonable
+  // thing to do to avoid reallocations. Likewise, a translation tends to have
+  // about as many words as its source.
+  response.target.text.reserve(response.source.view().size());
+  size_t sourceWords = 0;
+  for (size_t sentenceIdx = 0; sentenceIdx < response.source.numSentences(); sentenceIdx++) {
+    sourceWords += response.source.numWords(sentenceIdx);
+  }
+  response.target.reserve(histories.size(), sourceWords + histories.size() /* EOS */);
+
+  if (responseOptions_.qualityScores) {
+    response.qualityScores.resize(histories.size());
+  }
+  if (responseOptions_.alignment) {
+    response.alignments.resize(histories.size());
+  }
+
+  // targetWords refer to decoded or the source until appended to the target.
+  std::string decoded;
+  std::vector<string_view> targetWords;
+  for (size_t sentenceIdx = 0; sentenceIdx < histories.size(); sentenceIdx++) {
+    targetWords.clear();
+    if (histories[sentenceIdx] == nullptr) {
+      buildPassthroughSentence(sentenceIdx, response, targetWords);
+    } else {
+      buildSentence(sentenceIdx, *histories[sentenceIdx], response, decoded, targetWords);
+    }
+    appendTargetSentence(sentenceIdx, targetWords, response);
+  }
 
-    Result result = onebest[0];  // Expecting only one result;
-    Words words = std::get<0>(result);
-    auto hyp = std::get<1>(result);
+  // Once complete, hand the Response over.
+  callback_(std::move(response));
+}
+
+void ResponseBuilder::buildSentence(size_t sentenceIdx, const History &history, Response &response,
+                                    std::string &decoded, std::vector<string_view> &targetWords) {
+  // TODO(jerin): Change hardcode of nBest = 1
+  // The best hypothesis is traced back once for its words and score, and its
+  // alignment and word scores read off the same hypothesis.
+  Result result = history.top();
+  const Words &words = std::get<0>(result);
+  const auto &hyp = std::get<1>(result);
+  vocabs_.target()->decodeWithByteRanges(words, decoded, targetWords);
+
+  if (responseOptions_.qualityScores) {
     // Quality scores: Sequence level is obtained as normalized path scores.
     // Word level using hypothesis traceback. These are most-likely
     // logprobs.
-    auto normalizedPathScore = std::get<2>(result);
-    auto wordQualities = hyp->tracebackWordScores();
-    wordQualities.pop_back();
-    response.qualityScores.push_back(Quality{normalizedPathScore, wordQualities});
+    Quality &quality = response.qualityScores[sentenceIdx];
+    quality.sequence = std::get<2>(result);
+    quality.word = hyp->tracebackWordScores();
+    quality.word.pop_back();
   }
-}
 
-void ResponseBuilder::buildAlignments(Histories &histories, Response &response) {
-  for (auto &history : histories) {
-    // TODO(jerin): Change hardcode of nBest = 1
-    NBestList onebest = history->nBest(1);
-
-    Result result = onebest[0];  // Expecting only one result;
-    Words words = std::get<0>(result);
-    // Alignments
-    // TODO(jerinphilip): The following double conversion might not be
-    // necessary. Hard alignment can directly be exported, but this would
-    // mean WASM bindings for a structure deep within marian source.
-    auto hyp = std::get<1>(result);
+  if (responseOptions_.alignment) {
     auto softAlignment = hyp->tracebackAlignment();
-    auto threshold = responseOptions_.alignmentThreshold;
-    auto hardAlignment = data::ConvertSoftAlignToHardAlign(softAlignment, threshold);
-    Alignment unified_alignment;
-    for (auto &p : hardAlignment) {
-      unified_alignment.emplace_back(Point{p.srcPos, p.tgtPos, p.prob});
-    }
-
-    response.alignments.push_back(std::move(unified_alignment));
+    hardAlign(softAlignment, responseOptions_.alignmentThreshold, responseOptions_.alignmentArgmax,
+              response.alignments[sentenceIdx]);
   }
 }
 
-void ResponseBuilder::buildTranslatedText(Histories &histories, Response &response) {
-  // Reserving length at least as much as source_ seems like a reasonable
-  // thing to do to avoid reallocations.
-  response.target.text.reserve(response.source.text.size());
+void ResponseBuilder::buildPassthroughSentence(size_t sentenceIdx, Response &response,
+                                               std::vector<string_view> &targetWords) {
+  // The source words are the translation. The model was not consulted, so
+  // nothing is known about the copy either way.
+  size_t numWords = response.source.numWords(sentenceIdx);
+  for (size_t wordIdx = 0; wordIdx < numWords; wordIdx++) {
+    targetWords.push_back(response.source.word(sentenceIdx, wordIdx));
+  }
 
-  for (size_t sentenceIdx = 0; sentenceIdx < histories.size(); sentenceIdx++) {
-    // TODO(jerin): Change hardcode of nBest = 1
-
-    auto &history = histories[sentenceIdx];
-    NBestList onebest = history->nBest(1);
-
-    Result result = onebest[0];  // Expecting only one result;
-    Words words = std::get<0>(result);
-
-    std::string decoded;
-    std::vector<string_view> targetSentenceMappings;
-    vocabs_.target()->decodeWithByteRanges(words, decoded, targetSentenceMappings);
-
-    switch (responseOptions_.concatStrategy) {
-      case ConcatStrategy::FAITHFUL: {
-        // For each sentence, prepend the filler text between the corresponding
-        // source-sentence and the source-sentence before.
-        string_view pre = response.source.gap(sentenceIdx);
-        response.target.appendSentence(pre, targetSentenceMappings.begin(), targetSentenceMappings.end());
-
-        // If this is the last history to be decoded and translated-text
-        // constructed, append the text till the end, which could be spaces or
-        // empty.
-        if (sentenceIdx + 1 == histories.size()) {
-          response.target.appendEndingWhitespace(response.source.gap(sentenceIdx + 1));
-        }
-        break;
-      }
-      case ConcatStrategy::SPACE: {
-        string_view delimiter = (sentenceIdx == 0) ? "" : " ";
-        response.target.appendSentence(delimiter, targetSentenceMappings.begin(), targetSentenceMappings.end());
-        break;
-      }
+  if (responseOptions_.qualityScores) {
+    response.qualityScores[sentenceIdx] = Quality{0.0f, std::vector<float>(numWords, 0.0f)};
+  }
 
-      default:
-        ABORT("Unknown concat-strategy");
+  if (responseOptions_.alignment) {
+    Alignment &alignment = response.alignments[sentenceIdx];
+    alignment.reserve(numWords);
+    for (size_t wordIdx = 0; wordIdx < numWords; wordIdx++) {
+      alignment.emplace_back(Point{static_cast<WordIndex>(wordIdx), static_cast<WordIndex>(wordIdx), 1.0f});
     }
   }
 }
 
+void ResponseBuilder::appendTargetSentence(size_t sentenceIdx, std::vector<string_view> &targetWords,
+                                           Response &response) {
+  switch (responseOptions_.concatStrategy) {
+    case ConcatStrategy::FAITHFUL: {
+      // For each sentence, prepend the filler text between the corresponding
+      // source-sentence and the source-sentence before.
+      string_view pre = response.source.gap(sentenceIdx);
+      response.target.appendSentence(pre, targetWords.begin(), targetWords.end());
+
+      // If this is the last history to be decoded and translated-text
+      // constructed, append the text till the end, which could be spaces or
+      // empty.
+      if (sentenceIdx + 1 == response.source.numSentences()) {
+        response.target.appendEndingWhitespace(response.source.gap(sentenceIdx + 1));
+      }
+      break;
+    }
+    case ConcatStrategy::SPACE: {
+      string_view delimiter = (sentenceIdx == 0) ? "" : " ";
+      response.target.appendSentence(delimiter, targetWords.begin(), targetWords.end());
+      break;
+    }
+
+    default:
+      ABORT("Unknown concat-strategy");
+  }
+}
+
 }  // namespace bergamot
 }  // namespace marian
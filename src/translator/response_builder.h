@@ -1,6 +1,8 @@
 #ifndef SRC_BERGAMOT_RESPONSE_BUILDER_H_
 #define SRC_BERGAMOT_RESPONSE_BUILDER_H_
 
+#include <functional>
+
 #include "data/types.h"
 #include "response.h"
 #include "response_options.h"
@@ -12,8 +14,11 @@
 namespace marian {
 namespace bergamot {
 
+/// Called with the Response once a Request is translated.
+typedef std::function<void(Response &&)> CallbackType;
+
 /// ResponseBuilder is a callback functor. It is expected to be bound to a
-/// Request after giving it the context of options, vocabs and promise to set.
+/// Request after giving it the context of options, vocabs and callback to call.
 /// It constructs the Response and it's members based on options
 /// (quality=on|off, alignments=on|off, mappings=on|off, splitmode=sentence |
 /// paragraph).
@@ -23,66 +28,44 @@ class ResponseBuilder {
   /// @param [in] responseOptions: ResponseOptions, indicating what to include
   /// or not in the response and any additional configurable parameters.
   /// @param [in] vocabs: marian vocab object (used in decoding)
-  /// @param [in] promise: promise to set with the constructed Response.
-  ResponseBuilder(ResponseOptions responseOptions, AnnotatedText &&source, Vocabs &vocabs,
-                  std::promise<Response> &&promise)
-      : responseOptions_(responseOptions), source_(std::move(source)), vocabs_(vocabs), promise_(std::move(promise)) {}
-
-  /// Constructs and sets the promise of a Response object from obtained
-  /// histories after translating.
+  /// @param [in] callback: called with the constructed Response.
+  ResponseBuilder(ResponseOptions responseOptions, AnnotatedText &&source, Vocabs &vocabs, CallbackType callback)
+      : responseOptions_(responseOptions),
+        source_(std::move(source)),
+        vocabs_(vocabs),
+        callback_(std::move(callback)) {}
+
+  /// Constructs a Response object from obtained histories after translating,
+  /// and calls the callback with it.
   /// @param [in] histories: Histories obtained after translating the Request
-  /// from which this functor is called.
-  void operator()(Histories &&histories) {
-    // TODO(jerinphilip) load ResponseOptions into options and turn build
-    // functions on or off.
-    // responseOptions_ is unused, but we can try something here.
-    ABORT_IF(source_.numSentences() != histories.size(), "Mismatch in source and translated sentences");
-    Response response;
-
-    // Move source_ into response.
-    response.source = std::move(source_);
-
-    // Should be after source is set
-    buildTranslatedText(histories, response);
-
-    // Should always be after buildTranslatedText
-    if (responseOptions_.qualityScores) {
-      buildQualityScores(histories, response);
-    }
-
-    if (responseOptions_.alignment) {
-      buildAlignments(histories, response);
-    }
-
-    // Once complete, set promise.
-    promise_.set_value(std::move(response));
-  }
+  /// from which this functor is called. A nullptr history marks a sentence
+  /// passed through untranslated: its source words are copied to the target,
+  /// aligned one to one, with zero quality scores.
+  void operator()(Histories &&histories);
 
  private:
-  /// Builds qualityScores from histories and writes to response. expects
-  /// buildTranslatedText to be run before to be able to obtain target text and
-  /// subword information.
-  /// @param histories [in]
-  /// @param response [out]
-  void buildQualityScores(Histories &histories, Response &response);
+  /// Builds the sentence at sentenceIdx of response from history in a single
+  /// pass: decodes its words into decoded, setting targetWords to them, and
+  /// fills in its quality scores and alignment if asked for.
+  void buildSentence(size_t sentenceIdx, const History &history, Response &response, std::string &decoded,
+                     std::vector<string_view> &targetWords);
 
-  /// Builds alignments from histories and writes onto response.
-  /// @param histories [in]
-  /// @param response [out]
-  void buildAlignments(Histories &histories, Response &response);
+  /// Builds the sentence at sentenceIdx of response passed through without a
+  /// history: sets targetWords to the source words, and fills in identity
+  /// alignment and zero quality scores if asked for.
+  void buildPassthroughSentence(size_t sentenceIdx, Response &response, std::vector<string_view> &targetWords);
 
-  /// Builds translated text and subword annotations and writes onto response.
-  /// @param histories [in]
-  /// @param response [out]
-  void buildTranslatedText(Histories &histories, Response &response);
+  /// Appends targetWords as the sentence at sentenceIdx to the target text,
+  /// joined as concatStrategy says.
+  void appendTargetSentence(size_t sentenceIdx, std::vector<string_view> &targetWords, Response &response);
 
   // Data members are context/curried args for the functor.
 
   ResponseOptions responseOptions_;
   const Vocabs &vocabs_;            // vocabs are required for decoding
                                     // and any source validation checks.
-  std::promise<Response> promise_;  //  To be set when callback triggered and
-                                    //  after Response constructed.
+  CallbackType callback_;  //  To be called when triggered and after Response
+                           //  constructed.
   AnnotatedText source_;
 };
 }  // namespace bergamot
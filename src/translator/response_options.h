@@ -40,8 +40,19 @@ struct ResponseOptions {
   /// matrix).
   float alignmentThreshold{0.2f};
 
+  /// Align each target (sub-)word only to the source (sub-)word it is aligned
+  /// to most, whatever alignmentThreshold is. Gives one Point per target word,
+  /// which is all that placing markup or highlighting needs.
+  bool alignmentArgmax{false};
+
   QualityScoreType qualityScoreType{QualityScoreType::FREE};
   ConcatStrategy concatStrategy{ConcatStrategy::FAITHFUL};
+
+  /// Whether the source is HTML. Only its text is translated; the markup is
+  /// restored in the Response around the source and translated text (see
+  /// HTML). Tags are placed in the translation using alignments, which are
+  /// computed for this even if not included in the Response.
+  bool HTML{false};
 };
 
 }  // namespace bergamot
@@ -12,6 +12,22 @@ namespace bergamot {
 SentenceSplitter::SentenceSplitter(marian::Ptr<marian::Options> options) : options_(options) {
   std::string smode_str = options_->get<std::string>("ssplit-mode", "");
   mode_ = string2splitmode(smode_str);
+  switch (mode_) {
+    case ug::ssplit::SentenceStream::splitmode::one_sentence_per_line:
+      nativeMode_ = ONE_SENTENCE_PER_LINE;
+      break;
+    case ug::ssplit::SentenceStream::splitmode::one_paragraph_per_line:
+      nativeMode_ = ONE_PARAGRAPH_PER_LINE;
+      break;
+    default:
+      nativeMode_ = WRAPPED_TEXT;
+  }
+
+  std::string backend = options_->get<std::string>("ssplit-backend", "ssplit");
+  ABORT_IF(backend != "ssplit" && backend != "native", "Unknown ssplit-backend {}, expected ssplit or native",
+           backend);
+  useNative_ = (backend == "native");
+
   std::string ssplit_prefix_file = options_->get<std::string>("ssplit-prefix-file", "");
 
   if (ssplit_prefix_file.size()) {
@@ -19,7 +35,11 @@ SentenceSplitter::SentenceSplitter(marian::Ptr<marian::Options> options) : optio
 
     LOG(info, "Loading protected prefixes for sentence splitting from {}", ssplit_prefix_file);
 
-    ssplit_.load(ssplit_prefix_file);
+    if (useNative_) {
+      native_.load(ssplit_prefix_file);
+    } else {
+      ssplit_.load(ssplit_prefix_file);
+    }
   } else {
     LOG(warn,
         "Missing list of protected prefixes for sentence splitting. "
@@ -27,9 +47,22 @@ SentenceSplitter::SentenceSplitter(marian::Ptr<marian::Options> options) : optio
   }
 }
 
-ug::ssplit::SentenceStream SentenceSplitter::createSentenceStream(const string_view &input) {
+bool SentenceStream::operator>>(std::string_view &sentence) {
+  if (nativeStream_) {
+    return *nativeStream_ >> sentence;
+  }
+  return static_cast<bool>(*ssplitStream_ >> sentence);
+}
+
+SentenceStream SentenceSplitter::createSentenceStream(const string_view &input) {
   std::string_view input_converted(input.data(), input.size());
-  return std::move(ug::ssplit::SentenceStream(input_converted, this->ssplit_, mode_));
+  SentenceStream stream;
+  if (useNative_) {
+    stream.nativeStream_.emplace(input_converted, native_, nativeMode_);
+  } else {
+    stream.ssplitStream_.emplace(input_converted, ssplit_, mode_);
+  }
+  return stream;
 }
 
 ug::ssplit::SentenceStream::splitmode SentenceSplitter::string2splitmode(const std::string &m) {
@@ -43,5 +76,9 @@ ug::ssplit::SentenceStream::splitmode SentenceSplitter::string2splitmode(const s
   return splitmode::wrapped_text;
 }
 
+bool lineBreakEndsParagraph(const std::string &mode) {
+  return mode == "sentence" || mode == "Sentence" || mode == "paragraph" || mode == "Paragraph";
+}
+
 }  // namespace bergamot
 }  // namespace marian
@@ -1,32 +1,58 @@
 #ifndef SRC_BERGAMOT_SENTENCE_SPLITTER_H_
 #define SRC_BERGAMOT_SENTENCE_SPLITTER_H_
 
+#include <optional>
 #include <string>
+#include <string_view>
 
 #include "common/options.h"
 #include "data/types.h"
 #include "definitions.h"
+#include "native_sentence_splitter.h"
 #include "ssplit.h"
 
 namespace marian {
 namespace bergamot {
 
+/// Sentences of a text as split by either backend of SentenceSplitter.
+class SentenceStream {
+ public:
+  /// Sets sentence to the next sentence, returns false at the end of text.
+  bool operator>>(std::string_view &sentence);
+
+ private:
+  friend class SentenceSplitter;
+  std::optional<ug::ssplit::SentenceStream> ssplitStream_;
+  std::optional<NativeSentenceStream> nativeStream_;
+};
+
 class SentenceSplitter {
   // A wrapper around @ugermann's ssplit-cpp compiled from several places in
   // mts. Constructed based on options. Used in TextProcessor below to create
   // sentence-streams, which provide access to one sentence from blob of text at
   // a time.
+  //
+  // With --ssplit-backend native, sentences are split by
+  // NativeSentenceSplitter instead, which applies the same rules without
+  // regular expressions.
  public:
   explicit SentenceSplitter(Ptr<Options> options);
-  ug::ssplit::SentenceStream createSentenceStream(string_view const &input);
+  SentenceStream createSentenceStream(string_view const &input);
 
  private:
   ug::ssplit::SentenceSplitter ssplit_;
+  NativeSentenceSplitter native_;
+  bool useNative_;
   Ptr<Options> options_;
   ug::ssplit::SentenceStream::splitmode mode_;
+  SplitMode nativeMode_;
   ug::ssplit::SentenceStream::splitmode string2splitmode(const std::string &m);
 };
 
+/// Whether every line break ends a sentence or paragraph in ssplit-mode mode
+/// (sentence, paragraph), rather than only an empty line (wrapped_text).
+bool lineBreakEndsParagraph(const std::string &mode);
+
 }  // namespace bergamot
 }  // namespace marian
 
@@ -5,54 +5,94 @@
 
 #include "batch.h"
 #include "definitions.h"
+#include "html.h"
+#include "pivot_response_builder.h"
 
 namespace marian {
 namespace bergamot {
 
 Service::Service(Ptr<Options> options, MemoryBundle memoryBundle)
-    : requestId_(0),
+    : numWorkers_(std::max<int>(1, options->get<int>("cpu-threads"))),
+      lazyWorkers_(options->get<bool>("lazy-workers", false)),
+      offlineBatching_(options->get<bool>("offline-batching", false)),
+      handOffTokens_(std::min<int>(options->get<int>("hand-off-tokens", 0), options->get<int>("mini-batch-words"))),
       options_(options),
-      vocabs_(options, std::move(memoryBundle.vocabs)),
-      text_processor_(vocabs_, options),
-      batcher_(options),
-      numWorkers_(std::max<int>(1, options->get<int>("cpu-threads"))),
-      modelMemory_(std::move(memoryBundle.model)),
-      shortlistMemory_(std::move(memoryBundle.shortlist))
-#ifdef WASM_COMPATIBLE_SOURCE
-      ,
-      blocking_translator_(DeviceId(0, DeviceType::cpu), vocabs_, options_, &modelMemory_, &shortlistMemory_)
-#endif
-{
-#ifdef WASM_COMPATIBLE_SOURCE
-  blocking_translator_.initialize();
-#else
+      requestId_(0),
+      model_(New<TranslationModel>(options, std::move(memoryBundle), numWorkers_,
+                                   /*initializedReplicas=*/lazyWorkers_ ? 0 : numWorkers_)) {
+#ifndef WASM_COMPATIBLE_SOURCE
+  int completionThreads = options->get<int>("completion-threads", 0);
+  if (completionThreads > 0) {
+    completionExecutor_.reset(new CompletionExecutor(completionThreads));
+  }
+
+  if (handOffTokens_ > 0) {
+    batcher_.enableHandOff(numWorkers_);
+  }
+
+  std::lock_guard<std::mutex> lock(workersMutex_);
   workers_.reserve(numWorkers_);
-  for (size_t cpuId = 0; cpuId < numWorkers_; cpuId++) {
-    workers_.emplace_back([cpuId, this] {
-      marian::DeviceId deviceId(cpuId, DeviceType::cpu);
-      BatchTranslator translator(deviceId, vocabs_, options_, &modelMemory_, &shortlistMemory_);
-      translator.initialize();
-      Batch batch;
-      // Run thread mainloop
-      while (batcher_ >> batch) {
-        translator.translate(batch);
+  if (!lazyWorkers_) {
+    for (size_t workerId = 0; workerId < numWorkers_; workerId++) {
+      spawnWorker();
+    }
+  }
+#endif
+}
+
+void Service::spawnWorker() {
+#ifndef WASM_COMPATIBLE_SOURCE
+  if (shuttingDown_ || workers_.size() >= numWorkers_) {
+    return;
+  }
+  size_t workerId = workers_.size();
+  workers_.emplace_back([workerId, this] {
+    Ptr<TranslationModel> model;
+    Batch batch;
+    // Run thread mainloop
+    while (batcher_.generateBatch(workerId, model, batch)) {
+      // Taking this batch can leave sentences queued with no worker waiting
+      // for them, in which case the next worker is started.
+      if (lazyWorkers_) {
+        spawnWorkersIfBacklogged();
       }
-    });
+      model->translateBatch(workerId, batch);
+      // Drop the reference while waiting for the next batch, so that a model
+      // replaced by reload() is released once its sentences drain.
+      model = nullptr;
+    }
+  });
+#endif
+}
+
+void Service::spawnWorkersIfBacklogged() {
+#ifndef WASM_COMPATIBLE_SOURCE
+  // A started worker is only seen as waiting once it reaches the batcher, so
+  // at most one worker is started per call. The started worker does the same
+  // after taking its batch, which ramps up workers while the backlog lasts.
+  if (batcher_.backlogged()) {
+    std::lock_guard<std::mutex> lock(workersMutex_);
+    spawnWorker();
   }
 #endif
 }
 
 void Service::blockIfWASM() {
 #ifdef WASM_COMPATIBLE_SOURCE
+  Ptr<TranslationModel> model;
   Batch batch;
   // There's no need to do shutdown here because it's single threaded.
-  while (batcher_ >> batch) {
-    blocking_translator_.translate(batch);
+  while (batcher_.generateBatch(model, batch)) {
+    model->translateBatch(/*workerId=*/0, batch);
   }
 #endif
 }
 
 std::vector<Response> Service::translateMultiple(std::vector<std::string> &&inputs, ResponseOptions responseOptions) {
+  if (offlineBatching_ && !std::atomic_load(&pivotModel_)) {
+    return translateOffline(std::move(inputs), responseOptions);
+  }
+
   // We queue the individual Requests so they get compiled at batches to be
   // efficiently translated.
   std::vector<std::future<Response>> responseFutures;
@@ -76,34 +116,334 @@ std::vector<Response> Service::translateMultiple(std::vector<std::string> &&inpu
   return responses;
 }
 
-std::future<Response> Service::queueRequest(std::string &&input, ResponseOptions responseOptions) {
-  Segments segments;
-  AnnotatedText source(std::move(input));
-  text_processor_.process(source, segments);
+std::vector<Response> Service::translateOffline(std::vector<std::string> &&inputs, ResponseOptions responseOptions) {
+  // All inputs are split and tokenized before any sentence is queued, and then
+  // queued at once. Workers thus cut every batch from the sentences of all
+  // inputs, which the batcher keeps sorted by length, rather than from
+  // whatever was queued when they asked.
+  Ptr<TranslationModel> model = activeModel();
+  std::vector<Ptr<Request>> requests;
+  std::vector<std::future<Response>> responseFutures;
+  requests.reserve(inputs.size());
+  responseFutures.reserve(inputs.size());
+  for (auto &input : inputs) {
+    auto responsePromise = std::make_shared<std::promise<Response>>();
+    responseFutures.push_back(responsePromise->get_future());
+    CallbackType callback = [responsePromise](Response &&response) {
+      responsePromise->set_value(std::move(response));
+    };
 
-  std::promise<Response> responsePromise;
-  auto future = responsePromise.get_future();
+    AnnotatedText source(std::move(input));
+    ResponseOptions inputOptions = responseOptions;
+    if (inputOptions.HTML) {
+      prepareHTML(source, inputOptions, callback);
+    }
+    Ptr<Request> request = model->makeRequest(requestId_++, std::move(source), inputOptions, std::move(callback));
+    request->setCompletionExecutor(completionExecutor_.get(), model);
+    requests.push_back(std::move(request));
+  }
 
-  ResponseBuilder responseBuilder(responseOptions, std::move(source), vocabs_, std::move(responsePromise));
-  Ptr<Request> request = New<Request>(requestId_++, std::move(segments), std::move(responseBuilder));
+  batcher_.addRequests(model, requests);
+  requests.clear();
+  if (lazyWorkers_) {
+    spawnWorkersIfBacklogged();
+  }
+  blockIfWASM();
 
-  batcher_.addWholeRequest(request);
+  // Responses are collected in the order of inputs, whatever order their
+  // sentences were translated in.
+  std::vector<Response> responses;
+  responses.reserve(responseFutures.size());
+  for (auto &future : responseFutures) {
+    responses.push_back(future.get());
+  }
+  return responses;
+}
+
+std::future<Response> Service::queueRequest(AnnotatedText &&source, ResponseOptions responseOptions,
+                                            DocumentSession *session) {
+  auto responsePromise = std::make_shared<std::promise<Response>>();
+  auto future = responsePromise->get_future();
+  CallbackType callback = [responsePromise](Response &&response) { responsePromise->set_value(std::move(response)); };
+  queueRequest(std::move(source), responseOptions, std::move(callback), session);
   return future;
 }
 
+void Service::queueRequest(AnnotatedText &&source, ResponseOptions responseOptions, CallbackType callback,
+                           DocumentSession *session) {
+  // The request holds on to the model for its lifetime, so it is translated
+  // with the model active at the time it was queued even if reload() happens
+  // in between.
+  Ptr<TranslationModel> model = activeModel();
+  Ptr<TranslationModel> pivotModel = std::atomic_load(&pivotModel_);
+
+  if (responseOptions.HTML) {
+    prepareHTML(source, responseOptions, callback);
+  }
+
+  if (pivotModel) {
+    ABORT_IF(session != nullptr, "Document sessions are not supported when translating through a pivot model.");
+    queuePivotRequest(model, pivotModel, std::move(source), responseOptions, std::move(callback));
+  } else {
+    if (session != nullptr) {
+      session->bind(model);
+    }
+    Ptr<Request> request =
+        model->makeRequest(requestId_++, std::move(source), responseOptions, std::move(callback), session);
+    request->setCompletionExecutor(completionExecutor_.get(), model);
+    if (!handOff(model, request)) {
+      batcher_.addWholeRequest(model, request);
+    }
+  }
+
+  if (lazyWorkers_) {
+    spawnWorkersIfBacklogged();
+  }
+}
+
+bool Service::handOff(Ptr<TranslationModel> model, Ptr<Request> request) {
+#ifdef WASM_COMPATIBLE_SOURCE
+  return false;
+#else
+  const std::vector<size_t> &pending = request->pendingSegments();
+  if (handOffTokens_ == 0 || pending.empty()) {
+    return false;
+  }
+  size_t maxTokens = 0;
+  for (size_t index : pending) {
+    maxTokens = std::max(maxTokens, request->segmentTokens(index));
+  }
+  if (pending.size() * maxTokens > handOffTokens_) {
+    return false;
+  }
+
+  Batch batch;
+  for (size_t index : pending) {
+    batch.add(RequestSentence(index, request));
+  }
+  return batcher_.handOff(model, batch);
+#endif
+}
+
+void Service::prepareHTML(AnnotatedText &source, ResponseOptions &responseOptions, CallbackType &callback) {
+  // Only the text content is processed and translated. Tags are put back
+  // into the Response using alignments, whether or not they were asked for.
+  string_view view = source.view();
+  std::string text = source.isBorrowed() ? std::string(view.data(), view.size()) : std::move(source.text);
+  auto html = std::make_shared<HTML>(text);
+  source = AnnotatedText(std::move(text));
+
+  bool alignment = responseOptions.alignment;
+  responseOptions.alignment = true;
+  // Tags follow the most aligned source word, so that is all that is needed
+  // when alignments are not asked for.
+  responseOptions.alignmentArgmax |= !alignment;
+  responseOptions.concatStrategy = ConcatStrategy::FAITHFUL;
+  callback = [html, alignment, callback = std::move(callback)](Response &&response) {
+    html->restore(response);
+    if (!alignment) {
+      response.alignments.clear();
+    }
+    callback(std::move(response));
+  };
+}
+
+void Service::queuePivotRequest(Ptr<TranslationModel> first, Ptr<TranslationModel> second, AnnotatedText &&source,
+                                const ResponseOptions &responseOptions, CallbackType callback) {
+  size_t requestId = requestId_++;
+  Segments segments;
+  first->process(source, segments);
+
+  // Each sentence is a Request of its own on either hop, so that a sentence
+  // is queued on the second model as soon as its first hop is translated,
+  // while other sentences are still on the first. Both hops share the workers
+  // through batcher_.
+  std::vector<AnnotatedText> sentences;
+  sentences.reserve(source.numSentences());
+  for (size_t sentenceIdx = 0; sentenceIdx < source.numSentences(); sentenceIdx++) {
+    sentences.push_back(source.extractSentence(sentenceIdx));
+  }
+  auto builder = std::make_shared<PivotResponseBuilder>(std::move(source), responseOptions, std::move(callback));
+
+  ResponseOptions hopOptions = responseOptions;
+  hopOptions.concatStrategy = ConcatStrategy::FAITHFUL;
+  for (size_t sentenceIdx = 0; sentenceIdx < sentences.size(); sentenceIdx++) {
+    // Called by the worker translating the first hop.
+    CallbackType queueSecondHop = [this, builder, second, requestId, sentenceIdx,
+                                   hopOptions](Response &&firstHopResponse) {
+      std::string pivot = firstHopResponse.target.text;
+      auto firstHop = std::make_shared<Response>(std::move(firstHopResponse));
+      CallbackType complete = [builder, sentenceIdx, firstHop](Response &&secondHop) {
+        builder->add(sentenceIdx, std::move(*firstHop), std::move(secondHop));
+      };
+      Ptr<Request> request = second->makeRequest(requestId, std::move(pivot), hopOptions, std::move(complete));
+      request->setCompletionExecutor(completionExecutor_.get(), second);
+      batcher_.addWholeRequest(second, request);
+      if (lazyWorkers_) {
+        spawnWorkersIfBacklogged();
+      }
+    };
+
+    Segments sentenceSegments;
+    sentenceSegments.push_back(std::move(segments[sentenceIdx]));
+    Ptr<Request> request = first->makeRequest(requestId, std::move(sentences[sentenceIdx]),
+                                              std::move(sentenceSegments), hopOptions, std::move(queueSecondHop));
+    request->setCompletionExecutor(completionExecutor_.get(), first);
+    batcher_.addWholeRequest(first, request);
+  }
+}
+
 std::future<Response> Service::translate(std::string &&input, ResponseOptions responseOptions) {
   std::future<Response> future = queueRequest(std::move(input), responseOptions);
   blockIfWASM();
   return future;
 }
 
+void Service::translate(std::string &&input, CallbackType callback, ResponseOptions responseOptions) {
+  queueRequest(std::move(input), responseOptions, std::move(callback));
+  blockIfWASM();
+}
+
+std::future<Response> Service::translate(string_view source, std::shared_ptr<const void> lifetime,
+                                         ResponseOptions responseOptions) {
+  std::future<Response> future = queueRequest(AnnotatedText(source, std::move(lifetime)), responseOptions);
+  blockIfWASM();
+  return future;
+}
+
+std::future<Response> Service::translate(DocumentSession &session, std::string &&input,
+                                         ResponseOptions responseOptions) {
+  std::future<Response> future = queueRequest(std::move(input), responseOptions, &session);
+  blockIfWASM();
+  return future;
+}
+
+size_t Service::replicasToInitialize() {
+  // With lazy workers, only the replicas of workers already started are
+  // initialized.
+  if (!lazyWorkers_) {
+    return numWorkers_;
+  }
+#ifdef WASM_COMPATIBLE_SOURCE
+  return 0;
+#else
+  std::lock_guard<std::mutex> lock(workersMutex_);
+  return workers_.size();
+#endif
+}
+
+void Service::reload(Ptr<Options> options, MemoryBundle memoryBundle) {
+  // Constructing the model loads and initializes its replicas, while workers
+  // continue to translate requests queued on the current model.
+  Ptr<TranslationModel> model =
+      New<TranslationModel>(options, std::move(memoryBundle), numWorkers_, replicasToInitialize());
+
+  // From here on new requests go to the new model. The previous model is
+  // referenced by the batcher and workers while it still has sentences to
+  // translate and is released after.
+  std::atomic_store(&model_, model);
+}
+
+void Service::setPivot(Ptr<Options> options, MemoryBundle memoryBundle) {
+  Ptr<TranslationModel> pivotModel =
+      New<TranslationModel>(options, std::move(memoryBundle), numWorkers_, replicasToInitialize());
+  std::atomic_store(&pivotModel_, pivotModel);
+}
+
+void Service::clearPivot() { std::atomic_store(&pivotModel_, Ptr<TranslationModel>()); }
+
+void Service::warmup() {
+  std::vector<Ptr<TranslationModel>> models = {activeModel()};
+  if (Ptr<TranslationModel> pivotModel = std::atomic_load(&pivotModel_)) {
+    models.push_back(pivotModel);
+  }
+#ifdef WASM_COMPATIBLE_SOURCE
+  for (Ptr<TranslationModel> &model : models) {
+    model->warmup(/*workerId=*/0);
+  }
+#else
+  {
+    std::lock_guard<std::mutex> lock(workersMutex_);
+    for (size_t workerId = workers_.size(); workerId < numWorkers_; workerId++) {
+      spawnWorker();
+    }
+  }
+
+  // Replicas are locked while in use, so warming up one that its worker is
+  // translating with meanwhile is safe; it just waits its turn.
+  std::vector<std::thread> warmers;
+  warmers.reserve(numWorkers_);
+  for (size_t workerId = 0; workerId < numWorkers_; workerId++) {
+    warmers.emplace_back([&models, workerId]() {
+      for (Ptr<TranslationModel> &model : models) {
+        model->warmup(workerId);
+      }
+    });
+  }
+  for (std::thread &warmer : warmers) {
+    warmer.join();
+  }
+#endif
+}
+
+void Service::releaseIdleWorkers() {
+  std::vector<Ptr<TranslationModel>> models = {activeModel()};
+  if (Ptr<TranslationModel> pivotModel = std::atomic_load(&pivotModel_)) {
+    models.push_back(pivotModel);
+  }
+#ifdef WASM_COMPATIBLE_SOURCE
+  // Nothing translates in between calls.
+  std::vector<size_t> idleWorkers;
+  for (size_t workerId = 0; workerId < numWorkers_; workerId++) {
+    idleWorkers.push_back(workerId);
+  }
+#else
+  // A worker that picks up work meanwhile initializes its replica again.
+  std::vector<size_t> idleWorkers = batcher_.idleWorkers();
+#endif
+  for (Ptr<TranslationModel> &model : models) {
+    for (size_t workerId : idleWorkers) {
+      model->releaseReplica(workerId);
+    }
+  }
+}
+
 Service::~Service() {
-  batcher_.shutdown();
 #ifndef WASM_COMPATIBLE_SOURCE
-  for (std::thread &worker : workers_) {
+  // Workers can start further workers until shuttingDown_ is set, so they are
+  // taken out under the lock but joined without it.
+  size_t numWorkers;
+  {
+    std::lock_guard<std::mutex> lock(workersMutex_);
+    shuttingDown_ = true;
+    numWorkers = workers_.size();
+  }
+
+  // Responses built on completionExecutor_ may queue second hops of pivot
+  // requests, which need workers to translate them. So workers are only
+  // stopped once the executor and the batcher are idle together: the
+  // executor drained while workers were idle, and nothing was added since.
+  if (completionExecutor_ && numWorkers > 0) {
+    size_t added;
+    do {
+      added = batcher_.waitUntilIdle(numWorkers);
+      completionExecutor_->drain();
+    } while (batcher_.waitUntilIdle(numWorkers) != added);
+  }
+
+  batcher_.shutdown();
+  std::vector<std::thread> workers;
+  {
+    std::lock_guard<std::mutex> lock(workersMutex_);
+    workers = std::move(workers_);
+  }
+  for (std::thread &worker : workers) {
     assert(worker.joinable());
     worker.join();
   }
+  completionExecutor_.reset();
+#else
+  batcher_.shutdown();
 #endif
 }
 
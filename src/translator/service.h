@@ -1,19 +1,22 @@
 #ifndef SRC_BERGAMOT_SERVICE_H_
 #define SRC_BERGAMOT_SERVICE_H_
 
-#include "batch_translator.h"
+#include "completion_executor.h"
 #include "data/types.h"
+#include "document_session.h"
 #include "response.h"
 #include "response_builder.h"
-#include "text_processor.h"
 #include "threadsafe_batcher.h"
+#include "translation_model.h"
 #include "translator/parser.h"
-#include "vocabs.h"
 
 #ifndef WASM_COMPATIBLE_SOURCE
+#include <mutex>
 #include <thread>
 #endif
 
+#include <atomic>
+#include <memory>
 #include <queue>
 #include <vector>
 
@@ -92,6 +95,41 @@ class Service {
   /// parameters.
   std::future<Response> translate(std::string &&source, ResponseOptions options = ResponseOptions());
 
+  /// Translate an input, calling callback with the Response once translated
+  /// instead of returning a future. Responses of several inputs arrive as each
+  /// completes, in any order. callback is called on a worker (or completion)
+  /// thread, so it should hand the Response off rather than block.
+  ///
+  /// @param [in] source: rvalue reference of the string to be translated
+  /// @param [in] callback: called with the Response.
+  /// @param [in] responseOptions: as in translate().
+  void translate(std::string &&source, CallbackType callback, ResponseOptions responseOptions = ResponseOptions());
+
+  /// Translate an input borrowed from the caller, without copying it. The
+  /// Response's source refers to the same buffer. Useful for large inputs that
+  /// are already in memory, such as an mmapped file or a network buffer.
+  ///
+  /// @param [in] source: the text to be translated, which must remain valid
+  /// and unmodified while lifetime is held.
+  /// @param [in] lifetime: handle keeping source alive (e.g. a shared_ptr with
+  /// a deleter unmapping the file). Held until the request completes, and
+  /// after by the Response's source.
+  /// @param [in] responseOptions: as in translate().
+  std::future<Response> translate(string_view source, std::shared_ptr<const void> lifetime,
+                                  ResponseOptions responseOptions = ResponseOptions());
+
+  /// Translate a revision of the document tracked by session. Sentences whose
+  /// text is unchanged since the previous revision translated in session reuse
+  /// their translation; only new or edited sentences are decoded. The Response
+  /// is the same as translate() would produce for source. See DocumentSession.
+  ///
+  /// @param [in] session: DocumentSession keeping translations of the previous
+  /// revision, updated with those of source once translated.
+  /// @param [in] source: rvalue reference of the revision to be translated
+  /// @param [in] responseOptions: as in translate().
+  std::future<Response> translate(DocumentSession &session, std::string &&source,
+                                  ResponseOptions responseOptions = ResponseOptions());
+
   /// Translate multiple text-blobs in a single *blocking* API call, providing
   /// ResponseOptions which applies across all text-blobs dictating how to
   /// construct Response. ResponseOptions can be used to enable/disable
@@ -108,53 +146,181 @@ class Service {
   /// @param [in] translationRequest: ResponseOptions indicating whether or not
   /// to include some member in the Response, also specify any additional
   /// configurable parameters.
+  ///
+  /// With --offline-batching, all texts are split and tokenized before any
+  /// sentence is queued, so that batches are cut from the sentences of all
+  /// texts sorted by length. This packs batches best, for offline corpora where
+  /// only total throughput matters, at the cost of translation starting only
+  /// once all input is processed. Not applied when translating through a pivot.
   std::vector<Response> translateMultiple(std::vector<std::string> &&source, ResponseOptions responseOptions);
 
-  /// Returns if model is alignment capable or not.
-  bool isAlignmentSupported() const { return options_->hasAndNotEmpty("alignment"); }
+  /// Replaces the model with one constructed from options and memoryBundle,
+  /// without interrupting translation. The call blocks while the new model is
+  /// loaded and initialized, during which workers keep translating with the
+  /// current model. Once ready, requests queued from then on are translated
+  /// with the new model. Requests already queued complete on the previous model, whose
+  /// memory is released once they drain.
+  ///
+  /// @param [in] options: Marian options object for the new model.
+  /// @param [in] memoryBundle holds all byte-array memories for the new model.
+  /// Can be a set/subset of model, shortlist, vocabs and ssplitPrefixFile
+  /// bytes. Optional.
+  void reload(Ptr<Options> options, MemoryBundle memoryBundle = {});
+
+  /// Replaces the model with one constructed from a string configuration. See
+  /// reload(Ptr<Options>, MemoryBundle).
+  void reload(const std::string &config, MemoryBundle memoryBundle = {}) {
+    reload(parseOptions(config, /*validate=*/false), std::move(memoryBundle));
+  }
+
+  /// Translates through a pivot language from here on: the active model
+  /// translates source text into the pivot language, and the model constructed
+  /// from options and memoryBundle translates that on into the target
+  /// language. Each sentence moves on to the second model as soon as its
+  /// translation into the pivot language is done, and both models share the
+  /// workers. Alignments in the Response are composed across both hops. Like
+  /// reload(), the call blocks while the model is loaded, and requests already
+  /// queued are not affected.
+  ///
+  /// @param [in] options: Marian options object for the pivot to target model.
+  /// @param [in] memoryBundle holds all byte-array memories for that model.
+  /// Optional.
+  void setPivot(Ptr<Options> options, MemoryBundle memoryBundle = {});
+
+  /// Sets the pivot to target model from a string configuration. See
+  /// setPivot(Ptr<Options>, MemoryBundle).
+  void setPivot(const std::string &config, MemoryBundle memoryBundle = {}) {
+    setPivot(parseOptions(config, /*validate=*/false), std::move(memoryBundle));
+  }
+
+  /// Translates directly with the active model again.
+  void clearPivot();
+
+  /// Returns if model is alignment capable or not. When translating through a
+  /// pivot, both models need to be.
+  bool isAlignmentSupported() const {
+    Ptr<TranslationModel> pivotModel = std::atomic_load(&pivotModel_);
+    return activeModel()->isAlignmentSupported() && (!pivotModel || pivotModel->isAlignmentSupported());
+  }
+
+  /// Returns hits, misses and size of the sentence encoding cache of the
+  /// active model (see --encoding-cache-size), e.g. to monitor its hit rate.
+  EncodingCache::Stats encodingCacheStats() const { return activeModel()->encodingCacheStats(); }
+
+  /// Returns how many sentences the active model classified, and how many of
+  /// them it passed through untranslated (see --skip-translation).
+  PassthroughClassifier::Stats passthroughStats() const { return activeModel()->passthroughStats(); }
+
+  /// Starts all workers and translates a synthetic batch on each of them with
+  /// the active model, so that requests that follow do not pay for worker
+  /// start-up, graph initialization or first workspace allocation. Blocks until
+  /// all workers are warm. Useful with --lazy-workers, to warm up once at a
+  /// convenient time.
+  void warmup();
+
+  /// Releases the graph and workspace of the active model held by workers
+  /// currently waiting for work, to reduce memory while idle. Released workers
+  /// initialize their graph again on next use.
+  void releaseIdleWorkers();
 
  private:
-  /// Queue an input for translation.
-  std::future<Response> queueRequest(std::string &&input, ResponseOptions responseOptions);
+  /// Queue an input for translation, reusing translations kept by session if
+  /// given.
+  std::future<Response> queueRequest(AnnotatedText &&source, ResponseOptions responseOptions,
+                                     DocumentSession *session = nullptr);
+
+  /// Queue an input for translation as above, calling callback with the
+  /// Response.
+  void queueRequest(AnnotatedText &&source, ResponseOptions responseOptions, CallbackType callback,
+                    DocumentSession *session = nullptr);
+
+  /// Queues all inputs at once after processing them, and waits for their
+  /// Responses. See translateMultiple().
+  std::vector<Response> translateOffline(std::vector<std::string> &&inputs, ResponseOptions responseOptions);
+
+  /// Passes the sentences of request, if they pad to at most handOffTokens_
+  /// tokens, as a batch straight to a waiting worker rather than queueing them.
+  /// Returns false if not passed, e.g. as all workers are busy.
+  bool handOff(Ptr<TranslationModel> model, Ptr<Request> request);
+
+  /// Sets up source and callback to translate HTML: source is replaced by its
+  /// text content, and callback is wrapped to put the tags back into the
+  /// Response. responseOptions are adjusted to what that needs.
+  void prepareHTML(AnnotatedText &source, ResponseOptions &responseOptions, CallbackType &callback);
 
-  /// Dispatch call to translate after inserting in queue
-  void dispatchTranslate();
+  /// Queues input for translation with first into the pivot language and with
+  /// second on into the target language, sentence by sentence.
+  void queuePivotRequest(Ptr<TranslationModel> first, Ptr<TranslationModel> second, AnnotatedText &&source,
+                         const ResponseOptions &responseOptions, CallbackType callback);
 
-  /// Translates through direct interaction between batcher_ and translators_
+  /// Translates through direct interaction between batcher_ and the active model
   void blockIfWASM();
 
+  /// Number of replicas a newly loaded model initializes up front: all, or
+  /// with lazy workers those of the workers already started.
+  size_t replicasToInitialize();
+
+  /// Returns the model new requests are to be translated with.
+  Ptr<TranslationModel> activeModel() const { return std::atomic_load(&model_); }
+
+  /// Starts workers while sentences are queued and no started worker is
+  /// waiting for them, up to numWorkers_.
+  void spawnWorkersIfBacklogged();
+
+  /// Starts one more worker, unless numWorkers_ are already running or Service
+  /// is shutting down. Expects workersMutex_ to be held.
+  void spawnWorker();
+
   /// Number of workers to launch.
   size_t numWorkers_;
 
+  /// Whether workers are started (and their replicas initialized) on demand,
+  /// rather than all at construction.
+  bool lazyWorkers_;
+
+  /// Whether translateMultiple() queues all inputs at once (see
+  /// --offline-batching).
+  bool offlineBatching_;
+
+  /// Requests whose sentences pad to at most this many tokens go straight to
+  /// a waiting worker (see --hand-off-tokens). 0 disables.
+  size_t handOffTokens_;
+
   /// Options object holding the options Service was instantiated with.
   Ptr<Options> options_;
 
-  /// Model memory to load model passed as bytes.
-  AlignedMemory modelMemory_;  // ORDER DEPENDENCY (translators_)
-  /// Shortlist memory passed as bytes.
-  AlignedMemory shortlistMemory_;  // ORDER DEPENDENCY (translators_)
-
   /// Stores requestId of active request. Used to establish
   /// ordering among requests and logging/book-keeping.
+  std::atomic<size_t> requestId_;
 
-  size_t requestId_;
-  /// Store vocabs representing source and target.
-  Vocabs vocabs_;  // ORDER DEPENDENCY (text_processor_)
+  /// Model new requests are translated with. Accessed atomically, as reload()
+  /// can replace it while requests are queued.
+  Ptr<TranslationModel> model_;
 
-  /// TextProcesser takes a blob of text and converts into format consumable by
-  /// the batch-translator and annotates sentences and words.
-  TextProcessor text_processor_;  // ORDER DEPENDENCY (vocabs_)
+  /// Model translating from the pivot language into the target language, if
+  /// translating through a pivot (see setPivot()). Accessed atomically.
+  Ptr<TranslationModel> pivotModel_;
 
-  /// Batcher handles generation of batches from a request, subject to
-  /// packing-efficiency and priority optimization heuristics.
+  /// Batcher handles generation of batches from requests on (possibly
+  /// multiple) models, subject to packing-efficiency and priority optimization
+  /// heuristics.
   ThreadsafeBatcher batcher_;
 
+  /// Builds Responses off the workers, if --completion-threads is set.
+  /// nullptr otherwise, and always without threads (WASM).
+  std::unique_ptr<CompletionExecutor> completionExecutor_;
+
   // The following constructs are available providing full capabilities on a non
   // WASM platform, where one does not have to hide threads.
-#ifdef WASM_COMPATIBLE_SOURCE
-  BatchTranslator blocking_translator_;  // ORDER DEPENDENCY (modelMemory_, shortlistMemory_)
-#else
+#ifndef WASM_COMPATIBLE_SOURCE
+  /// Started workers, indexed by worker id. Guarded by workersMutex_, as
+  /// workers can be started from any thread queueing requests.
   std::vector<std::thread> workers_;
+
+  /// Set by the destructor to stop further workers from being started.
+  bool shuttingDown_{false};
+
+  std::mutex workersMutex_;
 #endif  // WASM_COMPATIBLE_SOURCE
 };
 
@@ -0,0 +1,101 @@
+#include "stream_translator.h"
+
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sentence_splitter.h"
+
+namespace marian {
+namespace bergamot {
+
+namespace {
+
+/// Chunks are cut without a paragraph boundary at this many times
+/// --stream-chunk-bytes.
+const size_t kMaxChunkFactor = 4;
+
+bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v'; }
+
+/// Length of the first chunk of text, which is at least chunkBytes long: up to
+/// the first boundary no sentence crosses (a line break, or an empty line if
+/// !breakAtLines) after chunkBytes. If there is none by maxBytes,
+/// up to the first line break after chunkBytes, else likely sentence end (`.`,
+/// `?` or `!` followed by whitespace), else whitespace, else up to maxBytes,
+/// not within a UTF-8 character. Returns 0 if text is too short to tell yet.
+size_t chunkLength(const std::string &text, size_t chunkBytes, size_t maxBytes, bool breakAtLines) {
+  for (size_t lineBreak = text.find('\n', chunkBytes - 1); lineBreak != std::string::npos && lineBreak < maxBytes;
+       lineBreak = text.find('\n', lineBreak + 1)) {
+    if (breakAtLines || lineBreak == 0 || text[lineBreak - 1] == '\n') {
+      return lineBreak + 1;
+    }
+  }
+  if (text.size() < maxBytes) {
+    return 0;
+  }
+
+  size_t lineBreak = text.find('\n', chunkBytes);
+  if (lineBreak < maxBytes) {
+    return lineBreak + 1;
+  }
+  for (size_t i = chunkBytes; i + 1 < maxBytes; i++) {
+    if ((text[i] == '.' || text[i] == '?' || text[i] == '!') && isSpace(text[i + 1])) {
+      return i + 2;
+    }
+  }
+  for (size_t i = chunkBytes; i < maxBytes; i++) {
+    if (isSpace(text[i])) {
+      return i + 1;
+    }
+  }
+  size_t length = maxBytes;
+  while (length > chunkBytes && length < text.size() && (static_cast<unsigned char>(text[length]) & 0xC0) == 0x80) {
+    length--;
+  }
+  return length;
+}
+
+}  // namespace
+
+void translateStream(Service &service, Ptr<Options> options, std::istream &input,
+                     const ResponseOptions &responseOptions, const std::function<void(Response &&)> &consume) {
+  size_t chunkBytes = std::max<int>(1, options->get<int>("stream-chunk-bytes"));
+  size_t maxBytes = kMaxChunkFactor * chunkBytes;
+  size_t maxRequests = std::max<int>(1, options->get<int>("stream-max-requests"));
+  bool breakAtLines = lineBreakEndsParagraph(options->get<std::string>("ssplit-mode", ""));
+
+  std::deque<std::future<Response>> inFlight;
+  auto submit = [&](std::string &&chunk) {
+    if (inFlight.size() == maxRequests) {
+      consume(inFlight.front().get());
+      inFlight.pop_front();
+    }
+    inFlight.push_back(service.translate(std::move(chunk), responseOptions));
+  };
+
+  // Text read and not yet submitted, at most maxBytes + chunkBytes.
+  std::string text;
+  std::vector<char> buffer(chunkBytes);
+  while (input.read(buffer.data(), buffer.size()) || input.gcount() > 0) {
+    text.append(buffer.data(), input.gcount());
+    for (size_t length; text.size() >= chunkBytes &&
+                        (length = chunkLength(text, chunkBytes, maxBytes, breakAtLines)) > 0;) {
+      submit(text.substr(0, length));
+      text.erase(0, length);
+    }
+  }
+  if (!text.empty()) {
+    submit(std::move(text));
+  }
+
+  while (!inFlight.empty()) {
+    consume(inFlight.front().get());
+    inFlight.pop_front();
+  }
+}
+
+}  // namespace bergamot
+}  // namespace marian
@@ -0,0 +1,41 @@
+#ifndef SRC_BERGAMOT_STREAM_TRANSLATOR_H_
+#define SRC_BERGAMOT_STREAM_TRANSLATOR_H_
+
+#include <functional>
+#include <istream>
+
+#include "common/options.h"
+#include "response.h"
+#include "response_options.h"
+#include "service.h"
+
+namespace marian {
+namespace bergamot {
+
+/// Translates text read from input in bounded memory, for inputs too large to
+/// hold (several times over) at once.
+///
+/// Input is read in chunks of at least --stream-chunk-bytes, each extended to
+/// the next boundary no sentence crosses in the configured ssplit-mode (a line
+/// break, or an empty line for wrapped_text). So that memory stays bounded, a
+/// chunk without such a boundary (a long paragraph of wrapped_text, or a long
+/// line) is cut at 4 times --stream-chunk-bytes at the latest: at a line break
+/// if there is one, else after a likely sentence end or whitespace. A sentence
+/// crossing such a cut is translated as two. Every chunk is a Request of its
+/// own, with at most --stream-max-requests queued at any time: once the window
+/// is full, the oldest Request is waited for before reading on. Responses are
+/// passed to consume in input order. Target texts of consecutive Responses
+/// concatenate to the translation of the whole input.
+///
+/// @param [in] service: Service to translate with.
+/// @param [in] options: options holding the stream and ssplit-mode options.
+/// @param [in] input: stream to read the text to translate from, until end.
+/// @param [in] responseOptions: ResponseOptions for every chunk.
+/// @param [in] consume: called with each Response, in input order.
+void translateStream(Service &service, Ptr<Options> options, std::istream &input,
+                     const ResponseOptions &responseOptions, const std::function<void(Response &&)> &consume);
+
+}  // namespace bergamot
+}  // namespace marian
+
+#endif  // SRC_BERGAMOT_STREAM_TRANSLATOR_H_
@@ -1,5 +1,8 @@
 #include "text_processor.h"
 
+#include <algorithm>
+#include <cctype>
+#include <string>
 #include <vector>
 
 #include "annotation.h"
@@ -7,48 +10,188 @@
 #include "data/types.h"
 #include "definitions.h"
 
+#ifndef WASM_COMPATIBLE_SOURCE
+#include <thread>
+#endif
+
 namespace marian {
 namespace bergamot {
 
 Segment TextProcessor::tokenize(const string_view &segment, std::vector<string_view> &wordRanges) {
+  Segment words;
+  if (encodingCache_ && encodingCache_->find(segment, words, wordRanges)) {
+    return words;
+  }
+
   // vocabs_->sources().front() is invoked as we currently only support one source vocab
-  return vocabs_.sources().front()->encodeWithByteRanges(segment, wordRanges, /*addEOS=*/false, /*inference=*/true);
+  words = vocabs_.sources().front()->encodeWithByteRanges(segment, wordRanges, /*addEOS=*/false, /*inference=*/true);
+  if (encodingCache_) {
+    encodingCache_->insert(segment, words, wordRanges);
+  }
+  return words;
 }
 
+namespace {
+
+/// Chunks smaller than this are not worth a thread of their own.
+const size_t kMinChunkSize = 1 << 18;
+
+/// How good a place to break a sentence the start of token is: after clause
+/// punctuation, at the start of a word, or inside a word.
+int boundaryStrength(const string_view &previous, const string_view &token) {
+  // ASCII clause punctuation, the em dash, the fullwidth comma, semicolon and
+  // colon, and the ideographic comma and full stop.
+  static const std::vector<std::string> clauseEnds = {",", ";", ":", ")", "\xE2\x80\x94", "\xEF\xBC\x8C",
+                                                      "\xEF\xBC\x9B", "\xEF\xBC\x9A", "\xE3\x80\x81", "\xE3\x80\x82"};
+  for (const std::string &clauseEnd : clauseEnds) {
+    if (previous.size() >= clauseEnd.size() &&
+        previous.substr(previous.size() - clauseEnd.size()) == string_view(clauseEnd)) {
+      return 2;
+    }
+  }
+  // SentencePiece tokens starting a word include the whitespace before it.
+  if (!token.empty() && std::isspace(static_cast<unsigned char>(token.front()))) {
+    return 1;
+  }
+  return 0;
+}
+
+}  // namespace
+
 TextProcessor::TextProcessor(Vocabs &vocabs, Ptr<Options> options) : vocabs_(vocabs), sentence_splitter_(options) {
   max_length_break_ = options->get<int>("max-length-break");
   max_length_break_ = max_length_break_ - 1;
   ABORT_IF(max_length_break_ < 0, "max-length-break cannot be < 0");
+
+  std::string lengthBreakStrategy = options->get<std::string>("length-break-strategy", "fixed");
+  ABORT_IF(lengthBreakStrategy != "fixed" && lengthBreakStrategy != "boundary",
+           "Unknown length-break-strategy {}, expected fixed or boundary", lengthBreakStrategy);
+  breakAtBoundaries_ = (lengthBreakStrategy == "boundary");
+
+  numThreads_ = std::max<int>(1, options->get<int>("text-processing-threads", 1));
+
+  // In wrapped_text mode a line break continues the paragraph, only an empty
+  // line ends it. In the other modes every line break ends a sentence or
+  // paragraph.
+  paragraphBreak_ = lineBreakEndsParagraph(options->get<std::string>("ssplit-mode", "")) ? "\n" : "\n\n";
+
+  int encodingCacheSize = options->get<int>("encoding-cache-size", 0);
+  if (encodingCacheSize > 0) {
+    encodingCache_.reset(new EncodingCache(encodingCacheSize));
+  }
+}
+
+EncodingCache::Stats TextProcessor::encodingCacheStats() const {
+  return encodingCache_ ? encodingCache_->stats() : EncodingCache::Stats();
 }
 
 void TextProcessor::process(AnnotatedText &source, Segments &segments) {
-  string_view query = string_view(source.text);
-  auto sentenceStream = sentence_splitter_.createSentenceStream(query);
+  string_view text = source.view();
+  std::vector<std::string_view> chunks = chunk(std::string_view(text.data(), text.size()));
+
+  if (chunks.size() == 1) {
+    auto sentenceStream = sentence_splitter_.createSentenceStream(text);
+    std::string_view sentenceStringPiece;
+
+    while (sentenceStream >> sentenceStringPiece) {
+      marian::string_view sentence(sentenceStringPiece.data(), sentenceStringPiece.size());
+
+      std::vector<string_view> wordRanges;
+      Segment segment = tokenize(sentence, wordRanges);
+
+      // There are some cases where SentencePiece or vocab returns no words
+      // after normalization. 0 prevents any empty entries from being added.
+      if (segment.size() > 0) {
+        // Wrap segment into sentences of at most max_length_break_ tokens and
+        // tell source about them.
+        wrap(segment, wordRanges, segments, source);
+      }
+    }
+    return;
+  }
+
+  // Chunks are split and tokenized in parallel. The word ranges point into
+  // the source text, so merging them in order gives the same result as the serial
+  // path above.
+  std::vector<std::vector<TokenizedSentence>> chunkSentences(chunks.size());
+#ifdef WASM_COMPATIBLE_SOURCE
+  for (size_t chunkIdx = 0; chunkIdx < chunks.size(); chunkIdx++) {
+    processChunk(chunks[chunkIdx], chunkSentences[chunkIdx]);
+  }
+#else
+  std::vector<std::thread> threads;
+  threads.reserve(chunks.size());
+  for (size_t chunkIdx = 0; chunkIdx < chunks.size(); chunkIdx++) {
+    threads.emplace_back([this, &chunks, &chunkSentences, chunkIdx]() {
+      processChunk(chunks[chunkIdx], chunkSentences[chunkIdx]);
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+#endif
+
+  // All sentences are tokenized by now, so the annotation can be sized once.
+  // Wrapping only splits sentences further, adding no words.
+  size_t numSentences = 0, numWords = 0;
+  for (const std::vector<TokenizedSentence> &sentences : chunkSentences) {
+    numSentences += sentences.size();
+    for (const TokenizedSentence &sentence : sentences) {
+      numWords += sentence.wordRanges.size();
+    }
+  }
+  source.reserve(numSentences, numWords);
+  segments.reserve(segments.size() + numSentences);
+
+  for (std::vector<TokenizedSentence> &sentences : chunkSentences) {
+    for (TokenizedSentence &sentence : sentences) {
+      wrap(sentence.segment, sentence.wordRanges, segments, source);
+    }
+  }
+}
+
+std::vector<std::string_view> TextProcessor::chunk(std::string_view text) const {
+  std::vector<std::string_view> chunks;
+  size_t chunkSize = std::max(kMinChunkSize, text.size() / numThreads_ + 1);
+  size_t begin = 0;
+  while (numThreads_ > 1 && text.size() - begin > chunkSize) {
+    size_t end = text.find(paragraphBreak_, begin + chunkSize);
+    if (end == std::string_view::npos) {
+      break;
+    }
+    end += paragraphBreak_.size();
+    chunks.push_back(text.substr(begin, end - begin));
+    begin = end;
+  }
+  chunks.push_back(text.substr(begin));
+  return chunks;
+}
+
+void TextProcessor::processChunk(std::string_view chunk, std::vector<TokenizedSentence> &sentences) {
+  // The sentence splitter and vocabs are only read from, and each chunk has a
+  // sentence stream of its own.
+  auto sentenceStream = sentence_splitter_.createSentenceStream(string_view(chunk.data(), chunk.size()));
   std::string_view sentenceStringPiece;
 
   while (sentenceStream >> sentenceStringPiece) {
     marian::string_view sentence(sentenceStringPiece.data(), sentenceStringPiece.size());
 
-    std::vector<string_view> wordRanges;
-    Segment segment = tokenize(sentence, wordRanges);
-
-    // There are some cases where SentencePiece or vocab returns no words
-    // after normalization. 0 prevents any empty entries from being added.
-    if (segment.size() > 0) {
-      // Wrap segment into sentences of at most max_length_break_ tokens and
-      // tell source about them.
-      wrap(segment, wordRanges, segments, source);
+    TokenizedSentence tokenized;
+    tokenized.segment = tokenize(sentence, tokenized.wordRanges);
+    if (tokenized.segment.size() > 0) {
+      sentences.push_back(std::move(tokenized));
     }
   }
 }
 
 void TextProcessor::wrap(Segment &segment, std::vector<string_view> &wordRanges, Segments &segments,
                          AnnotatedText &source) {
-  for (size_t offset = 0; offset < segment.size(); offset += max_length_break_) {
+  size_t diff;
+  for (size_t offset = 0; offset < segment.size(); offset += diff) {
     auto start = segment.begin() + offset;
 
     size_t left = segment.size() - offset;
-    size_t diff = std::min(max_length_break_, left);
+    diff = breakAtBoundaries_ ? nextBreak(wordRanges, offset) : std::min(max_length_break_, left);
 
     segments.emplace_back(start, start + diff);
     segments.back().push_back(sourceEosId());
@@ -59,5 +202,38 @@ void TextProcessor::wrap(Segment &segment, std::vector<string_view> &wordRanges,
   }
 }
 
+size_t TextProcessor::nextBreak(const std::vector<string_view> &wordRanges, size_t offset) const {
+  size_t left = wordRanges.size() - offset;
+  if (left <= max_length_break_) {
+    return left;
+  }
+
+  // Breaking into as few pieces as needed, all close to the same length, keeps
+  // them in a narrow range of lengths that batch together instead of leaving a
+  // short remainder. The cut may move by up to a quarter of the maximum length
+  // to find a better boundary, as long as the rest still fits in as many
+  // pieces.
+  size_t pieces = (left + max_length_break_ - 1) / max_length_break_;
+  size_t target = (left + pieces - 1) / pieces;
+  size_t slack = max_length_break_ / 4;
+  size_t shortest = std::max({left - (pieces - 1) * max_length_break_, target > slack ? target - slack : 1,
+                              static_cast<size_t>(1)});
+  size_t longest = std::min(max_length_break_, target + slack);
+
+  size_t best = target;
+  int bestStrength = -1;
+  for (size_t length = shortest; length <= longest; length++) {
+    size_t cut = offset + length;
+    int strength = boundaryStrength(wordRanges[cut - 1], wordRanges[cut]);
+    size_t distance = (length > target) ? length - target : target - length;
+    size_t bestDistance = (best > target) ? best - target : target - best;
+    if (strength > bestStrength || (strength == bestStrength && distance < bestDistance)) {
+      best = length;
+      bestStrength = strength;
+    }
+  }
+  return best;
+}
+
 }  // namespace bergamot
 }  // namespace marian
@@ -1,12 +1,16 @@
 #ifndef SRC_BERGAMOT_TEXT_PROCESSOR_H_
 #define SRC_BERGAMOT_TEXT_PROCESSOR_H_
 
+#include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
 
 #include "annotation.h"
 #include "data/types.h"
 #include "data/vocab.h"
 #include "definitions.h"
+#include "encoding_cache.h"
 #include "sentence_splitter.h"
 #include "vocabs.h"
 
@@ -25,14 +29,38 @@ class TextProcessor {
 
   void process(AnnotatedText &source, Segments &segments);
 
+  // Hits and misses of the encoding cache (see --encoding-cache-size). All
+  // zero if the cache is disabled.
+  EncodingCache::Stats encodingCacheStats() const;
+
  private:
+  // A sentence as split and tokenized, before wrapping. Collected per chunk
+  // when processing in parallel.
+  struct TokenizedSentence {
+    Segment segment;
+    std::vector<string_view> wordRanges;
+  };
+
   // Tokenizes an input string, returns Words corresponding. Loads the
   // corresponding byte-ranges into tokenRanges.
   Segment tokenize(const string_view &input, std::vector<string_view> &tokenRanges);
 
+  // Cuts text into chunks ending at boundaries no sentence crosses in the
+  // configured ssplit-mode, roughly one per thread. Returns text as a single
+  // chunk if it is too small to be worth processing in parallel.
+  std::vector<std::string_view> chunk(std::string_view text) const;
+
+  // Splits and tokenizes chunk, appending its sentences to sentences.
+  void processChunk(std::string_view chunk, std::vector<TokenizedSentence> &sentences);
+
   // Wrap into sentences of at most max_length_break_ tokens and add to source.
   void wrap(Segment &sentence, std::vector<string_view> &tokenRanges, Segments &segments, AnnotatedText &source);
 
+  // Number of tokens from offset to put in the next wrapped sentence, in the
+  // boundary length-break strategy. Pieces are kept close to even in length,
+  // and cut where wordRanges has the strongest boundary near that length.
+  size_t nextBreak(const std::vector<string_view> &wordRanges, size_t offset) const;
+
   // shorthand, used only in truncate()
   // vocabs_->sources().front() is invoked as we currently only support one source vocab
   const Word sourceEosId() const { return vocabs_.sources().front()->getEosId(); }
@@ -40,6 +68,19 @@ class TextProcessor {
   const Vocabs &vocabs_;
   SentenceSplitter sentence_splitter_;
   size_t max_length_break_;
+
+  // Whether overlong sentences are cut at boundaries (see nextBreak) instead
+  // of every max_length_break_ tokens.
+  bool breakAtBoundaries_;
+
+  // Threads to split and tokenize large inputs on.
+  size_t numThreads_;
+
+  // Line break sequence that ends a paragraph in the configured ssplit-mode.
+  std::string paragraphBreak_;
+
+  // Cache of sentence encodings, nullptr if disabled.
+  std::unique_ptr<EncodingCache> encodingCache_;
 };
 
 }  // namespace bergamot
@@ -2,28 +2,42 @@
 #include "threadsafe_batcher.h"
 
 #include <cassert>
+#include <chrono>
+#include <thread>
 
 namespace marian {
 namespace bergamot {
 
-ThreadsafeBatcher::ThreadsafeBatcher(Ptr<Options> options) : backend_(options), enqueued_(0), shutdown_(false) {}
+namespace {
+
+/// How long a worker with nothing queued spins waiting for a hand-off before
+/// it parks.
+const auto kHandOffSpinTime = std::chrono::microseconds(50);
+
+}  // namespace
+
+ThreadsafeBatcher::ThreadsafeBatcher() : enqueued_(0), shutdown_(false) {}
 
 ThreadsafeBatcher::~ThreadsafeBatcher() { shutdown(); }
 
-void ThreadsafeBatcher::addSentenceWithPriority(RequestSentence &sentence) {
+size_t ThreadsafeBatcher::addWholeRequest(Ptr<TranslationModel> model, Ptr<Request> request) {
   std::unique_lock<std::mutex> lock(mutex_);
-  assert(!shutdown_);
-  backend_.addSentenceWithPriority(sentence);
-  ++enqueued_;
-  work_.notify_one();
+  // Workers still draining after shutdown may queue follow-up requests (the
+  // second hop of a pivot translation), which they then translate themselves.
+  size_t numSentences = backend_.addWholeRequest(model, request);
+  enqueued_ += numSentences;
+  added_++;
+  work_.notify_all();
+  return numSentences;
 }
 
-void ThreadsafeBatcher::addWholeRequest(Ptr<Request> request) {
+size_t ThreadsafeBatcher::addRequests(Ptr<TranslationModel> model, const std::vector<Ptr<Request>> &requests) {
   std::unique_lock<std::mutex> lock(mutex_);
-  assert(!shutdown_);
-  backend_.addWholeRequest(request);
-  enqueued_ += request->numSegments();
+  size_t numSentences = backend_.addRequests(model, requests);
+  enqueued_ += numSentences;
+  added_ += requests.size();
   work_.notify_all();
+  return numSentences;
 }
 
 void ThreadsafeBatcher::shutdown() {
@@ -32,15 +46,123 @@ void ThreadsafeBatcher::shutdown() {
   work_.notify_all();
 }
 
-bool ThreadsafeBatcher::operator>>(Batch &batch) {
+bool ThreadsafeBatcher::generateBatch(size_t workerId, Ptr<TranslationModel> &model, Batch &batch) {
   std::unique_lock<std::mutex> lock(mutex_);
-  work_.wait(lock, [this]() { return enqueued_ || shutdown_; });
-  bool ret = backend_ >> batch;
+  idle_.insert(workerId);
+  idle_cv_.notify_all();
+  if (workerId < handOffs_.size()) {
+    if (receiveHandOff(*handOffs_[workerId], lock, model, batch)) {
+      idle_.erase(workerId);
+      return true;
+    }
+  } else {
+    work_.wait(lock, [this]() { return enqueued_ || shutdown_; });
+  }
+  idle_.erase(workerId);
+  bool ret = backend_.generateBatch(model, batch);
   assert(ret || shutdown_);
   enqueued_ -= batch.size();
   return ret;
 }
 
+std::vector<size_t> ThreadsafeBatcher::idleWorkers() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return std::vector<size_t>(idle_.begin(), idle_.end());
+}
+
+bool ThreadsafeBatcher::backlogged() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return enqueued_ > 0 && idle_.empty();
+}
+
+size_t ThreadsafeBatcher::waitUntilIdle(size_t numWorkers) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  // A worker handed a batch is still in idle_ until it takes the batch.
+  auto handedOff = [this]() {
+    for (auto &handOff : handOffs_) {
+      int state = handOff->state.load();
+      if (state == FILLING || state == FULL) {
+        return true;
+      }
+    }
+    return false;
+  };
+  // Such a worker signals idle_cv_ again once done with the batch.
+  idle_cv_.wait(lock, [&]() { return !enqueued_ && idle_.size() >= numWorkers && !handedOff(); });
+  return added_;
+}
+
+void ThreadsafeBatcher::enableHandOff(size_t numWorkers) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (handOffs_.size() < numWorkers) {
+    handOffs_.emplace_back(new HandOff());
+  }
+}
+
+bool ThreadsafeBatcher::handOff(Ptr<TranslationModel> model, Batch &batch) {
+  // Spinning workers are preferred, as they take the batch without a wakeup.
+  for (int waiting : {SPINNING, PARKED}) {
+    for (auto &handOff : handOffs_) {
+      int state = waiting;
+      if (handOff->state.load(std::memory_order_relaxed) != waiting ||
+          !handOff->state.compare_exchange_strong(state, FILLING)) {
+        continue;
+      }
+      added_++;
+      handOff->model = std::move(model);
+      handOff->batch = std::move(batch);
+      batch.clear();
+      handOff->state.store(FULL, std::memory_order_release);
+      if (waiting == PARKED) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        work_.notify_all();
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadsafeBatcher::receiveHandOff(HandOff &handOff, std::unique_lock<std::mutex> &lock,
+                                       Ptr<TranslationModel> &model, Batch &batch) {
+  if (enqueued_ || shutdown_) {
+    return false;
+  }
+
+  // A worker leaves waiting by moving state from SPINNING or PARKED to BUSY.
+  // If handOff() moved it first, a batch is on its way and is taken instead.
+  handOff.state.store(SPINNING);
+  lock.unlock();
+  auto deadline = std::chrono::steady_clock::now() + kHandOffSpinTime;
+  bool parking = false;
+  while (handOff.state.load(std::memory_order_acquire) == SPINNING) {
+    if (enqueued_ || shutdown_ || std::chrono::steady_clock::now() > deadline) {
+      parking = true;
+      break;
+    }
+    std::this_thread::yield();
+  }
+  lock.lock();
+
+  int state = SPINNING;
+  if (parking && handOff.state.compare_exchange_strong(state, PARKED)) {
+    work_.wait(lock, [&]() { return enqueued_ || shutdown_ || handOff.state.load() == FULL; });
+    state = PARKED;
+    if (handOff.state.compare_exchange_strong(state, BUSY)) {
+      return false;
+    }
+  }
+
+  // handOff() fills without the lock, so this is brief.
+  while (handOff.state.load(std::memory_order_acquire) != FULL) {
+    std::this_thread::yield();
+  }
+  model = std::move(handOff.model);
+  batch = std::move(handOff.batch);
+  handOff.state.store(BUSY, std::memory_order_release);
+  return true;
+}
+
 }  // namespace bergamot
 }  // namespace marian
 #endif  // WASM_COMPATIBLE_SOURCE
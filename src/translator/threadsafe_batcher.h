@@ -2,13 +2,17 @@
 #ifndef SRC_BERGAMOT_THREADSAFE_BATCHER_H_
 #define SRC_BERGAMOT_THREADSAFE_BATCHER_H_
 
-#include "batcher.h"
+#include "aggregate_batcher.h"
 #include "common/options.h"
 #include "definitions.h"
 
 #ifndef WASM_COMPATIBLE_SOURCE
+#include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <set>
+#include <vector>
 #endif
 
 namespace marian {
@@ -16,38 +20,92 @@ namespace bergamot {
 
 #ifdef WASM_COMPATIBLE_SOURCE
 // No threads, no locks.
-typedef Batcher ThreadsafeBatcher;
+typedef AggregateBatcher ThreadsafeBatcher;
 #else
 
 class ThreadsafeBatcher {
  public:
-  explicit ThreadsafeBatcher(Ptr<Options> options);
+  ThreadsafeBatcher();
 
   ~ThreadsafeBatcher();
 
-  // Add sentences to be translated by calling these (see Batcher).  When
-  // done, call shutdown.
-  void addSentenceWithPriority(RequestSentence &sentence);
-  void addWholeRequest(Ptr<Request> request);
+  // Add sentences to be translated by calling these (see AggregateBatcher).
+  // When done, call shutdown.
+  size_t addWholeRequest(Ptr<TranslationModel> model, Ptr<Request> request);
+  // Adds all requests at once, so that no batch is generated before the last
+  // of them is in.
+  size_t addRequests(Ptr<TranslationModel> model, const std::vector<Ptr<Request>> &requests);
   void shutdown();
 
-  // Get a batch out of the batcher.  Return false to shutdown worker.
-  bool operator>>(Batch &batch);
+  // Get a batch and the model to translate it with out of the batcher, for the
+  // worker identified by workerId.  Return false to shutdown worker.
+  bool generateBatch(size_t workerId, Ptr<TranslationModel> &model, Batch &batch);
+
+  // Ids of the workers currently waiting for a batch.
+  std::vector<size_t> idleWorkers();
+
+  // Whether sentences are queued while no worker is waiting for them, i.e.
+  // more workers could be put to use.
+  bool backlogged();
+
+  // Blocks until nothing is queued and numWorkers workers wait in
+  // generateBatch() with no batch handed to them. Returns the number of
+  // requests and hand-offs added so far, which tells whether any were added
+  // in between two calls.
+  size_t waitUntilIdle(size_t numWorkers);
+
+  // Lets handOff() pass batches to the workers with ids below numWorkers.
+  // Call before any of them starts.
+  void enableHandOff(size_t numWorkers);
+
+  // Passes batch, to be translated with model, straight to a worker waiting
+  // in generateBatch(), without queueing its sentences. Returns false, leaving
+  // batch untouched, if no worker is waiting.
+  bool handOff(Ptr<TranslationModel> model, Batch &batch);
 
  private:
-  Batcher backend_;
+  enum HandOffState { BUSY, SPINNING, PARKED, FILLING, FULL };
+
+  // Where handOff() leaves a batch for a waiting worker. A worker with nothing
+  // queued spins on state for a while before it parks on work_, so that a
+  // batch handed to it soon after is picked up without a wakeup.
+  struct HandOff {
+    std::atomic<int> state{BUSY};
+    Ptr<TranslationModel> model;
+    Batch batch;
+  };
 
-  // Number of sentences in backend_;
-  size_t enqueued_;
+  // Waits in handOff for either a batch, returning true, or queued sentences
+  // or shutdown, returning false. Called and returns with lock held.
+  bool receiveHandOff(HandOff &handOff, std::unique_lock<std::mutex> &lock, Ptr<TranslationModel> &model,
+                      Batch &batch);
+
+  AggregateBatcher backend_;
+
+  // Number of sentences in backend_. Read without the lock by spinning
+  // workers.
+  std::atomic<size_t> enqueued_;
+
+  // Workers waiting in generateBatch.
+  std::set<size_t> idle_;
+
+  // Number of requests and hand-offs added.
+  std::atomic<size_t> added_{0};
 
   // Are we shutting down?
-  bool shutdown_;
+  std::atomic<bool> shutdown_;
+
+  // Indexed by worker id, if hand-off is enabled.
+  std::vector<std::unique_ptr<HandOff>> handOffs_;
 
   // Lock on this object.
   std::mutex mutex_;
 
   // Signaled when there are sentences to translate.
   std::condition_variable work_;
+
+  // Signaled when a worker starts waiting in generateBatch.
+  std::condition_variable idle_cv_;
 };
 
 #endif
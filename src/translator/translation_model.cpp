@@ -0,0 +1,214 @@
+#include "translation_model.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "byte_array_util.h"
+#include "common/logging.h"
+
+#ifndef WASM_COMPATIBLE_SOURCE
+#include <thread>
+#endif
+
+namespace marian {
+namespace bergamot {
+
+namespace {
+
+/// Builds the shortlist generator from shortlistMemory if available, otherwise
+/// from the file specified in options. Returns nullptr if no shortlist is
+/// configured.
+Ptr<data::ShortlistGenerator const> createShortlistGenerator(Ptr<Options> options, const Vocabs &vocabs,
+                                                             const AlignedMemory &shortlistMemory) {
+  if (!options->hasAndNotEmpty("shortlist")) {
+    return nullptr;
+  }
+
+  // Flag holds whether validate the bytearray (shortlist)
+  bool check = options->get<bool>("check-bytearray", false);
+  int srcIdx = 0, trgIdx = 1;
+  // vocabs.sources().front() is invoked as we currently only support one source vocab
+  bool shared_vcb = vocabs.sources().front() == vocabs.target();
+  if (shortlistMemory.size() > 0 && shortlistMemory.begin() != nullptr) {
+    return New<data::BinaryShortlistGenerator>(shortlistMemory.begin(), shortlistMemory.size(),
+                                               vocabs.sources().front(), vocabs.target(), srcIdx, trgIdx, shared_vcb,
+                                               check);
+  }
+
+  // Changed to BinaryShortlistGenerator to enable loading binary shortlist file
+  // This class also supports text shortlist file
+  return New<data::BinaryShortlistGenerator>(options, vocabs.sources().front(), vocabs.target(), srcIdx, trgIdx,
+                                             shared_vcb);
+}
+
+}  // namespace
+
+TranslationModel::TranslationModel(Ptr<Options> options, MemoryBundle &&memory, size_t replicas,
+                                   size_t initializedReplicas)
+    : options_(options),
+      memory_(std::move(memory)),
+      vocabs_(options, std::move(memory_.vocabs)),
+      textProcessor_(vocabs_, options),
+      passthroughClassifier_(options),
+      shortlistGenerator_(createShortlistGenerator(options_, vocabs_, memory_.shortlist)),
+      batcher_(options),
+      replicas_(replicas) {
+  ABORT_IF(replicas == 0, "At least one replica needs to be created.");
+  ABORT_IF(initializedReplicas > replicas, "Cannot initialize more replicas than there are.");
+
+  // Flag holds whether validate the bytearray (model). The header is checked
+  // up front as replicas rely on it to load the model. The content checksum
+  // only reads the model memory, so it runs alongside replica initialization
+  // and is waited on before the constructor returns.
+  bool check = options_->get<bool>("check-bytearray", false) && memory_.model.size() > 0;
+  if (check) {
+    ABORT_IF(!validateBinaryModel(memory_.model, memory_.model.size()),
+             "The binary file is invalid. Incomplete or corrupted download?");
+  }
+
+#ifdef WASM_COMPATIBLE_SOURCE
+  if (check) {
+    verifyModelChecksum(/*numThreads=*/1);
+  }
+  for (size_t workerId = 0; workerId < initializedReplicas; workerId++) {
+    replica(workerId);
+  }
+#else
+  std::future<void> checksumVerification;
+  if (check) {
+    checksumVerification = std::async(std::launch::async, [this, replicas]() { verifyModelChecksum(replicas); });
+  }
+
+  // No worker uses this model yet, so the replicas' locks are not needed.
+  std::vector<std::thread> initializers;
+  initializers.reserve(initializedReplicas);
+  for (size_t workerId = 0; workerId < initializedReplicas; workerId++) {
+    initializers.emplace_back([this, workerId]() { replica(workerId); });
+  }
+  for (std::thread &initializer : initializers) {
+    initializer.join();
+  }
+
+  if (checksumVerification.valid()) {
+    checksumVerification.get();
+  }
+#endif
+}
+
+Ptr<Request> TranslationModel::makeRequest(size_t requestId, AnnotatedText &&annotatedSource,
+                                           const ResponseOptions &responseOptions, CallbackType callback,
+                                           DocumentSession *session) {
+  Segments segments;
+  textProcessor_.process(annotatedSource, segments);
+
+  Histories cachedHistories;
+  std::function<void(const Histories &)> onComplete;
+  if (session != nullptr) {
+    cachedHistories = session->lookup(annotatedSource, onComplete);
+  }
+
+  // Sentences passed through never reach the batcher.
+  std::vector<bool> passthrough = passthroughClassifier_.classify(annotatedSource);
+
+  ResponseBuilder responseBuilder(responseOptions, std::move(annotatedSource), vocabs_, std::move(callback));
+  return New<Request>(requestId, std::move(segments), std::move(responseBuilder), std::move(cachedHistories),
+                      std::move(onComplete), std::move(passthrough));
+}
+
+Ptr<Request> TranslationModel::makeRequest(size_t requestId, AnnotatedText &&source, Segments &&segments,
+                                           const ResponseOptions &responseOptions, CallbackType callback) {
+  std::vector<bool> passthrough = passthroughClassifier_.classify(source);
+  ResponseBuilder responseBuilder(responseOptions, std::move(source), vocabs_, std::move(callback));
+  return New<Request>(requestId, std::move(segments), std::move(responseBuilder), /*cachedHistories=*/Histories(),
+                      /*onComplete=*/nullptr, std::move(passthrough));
+}
+
+BatchTranslator &TranslationModel::replica(size_t workerId) {
+  assert(workerId < replicas_.size());
+  std::unique_ptr<BatchTranslator> &translator = replicas_[workerId].translator;
+  if (!translator) {
+    marian::DeviceId deviceId(workerId, DeviceType::cpu);
+    translator.reset(new BatchTranslator(deviceId, vocabs_, options_, &memory_.model, shortlistGenerator_));
+    translator->initialize();
+  }
+  return *translator;
+}
+
+void TranslationModel::translateBatch(size_t workerId, Batch &batch) {
+#ifndef WASM_COMPATIBLE_SOURCE
+  std::lock_guard<std::mutex> lock(replicas_[workerId].mutex);
+#endif
+  replica(workerId).translate(batch);
+}
+
+void TranslationModel::warmup(size_t workerId) {
+  // Fill one batch with sentences of max-length-break tokens, which is roughly
+  // the largest workspace a real batch will need. The sentence is encoded with
+  // the vocab directly rather than through makeRequest(), so that warming up
+  // neither evicts from the encoding cache nor counts in any statistics.
+  size_t miniBatchWords = options_->get<int>("mini-batch-words");
+  size_t maxLengthBreak = options_->get<int>("max-length-break");
+  std::string sentence;
+  for (size_t word = 0; word + 1 < maxLengthBreak; word++) {
+    sentence += "a ";
+  }
+  sentence += "a.";
+
+  const Ptr<Vocab const> &vocab = vocabs_.sources().front();
+  std::vector<string_view> wordRanges;
+  Segment segment = vocab->encodeWithByteRanges(sentence, wordRanges, /*addEOS=*/false, /*inference=*/true);
+  if (segment.size() + 1 > maxLengthBreak) {
+    segment.resize(maxLengthBreak - 1);
+    wordRanges.resize(maxLengthBreak - 1);
+  }
+  segment.push_back(vocab->getEosId());
+
+  AnnotatedText source;
+  Segments segments;
+  for (size_t sentenceIdx = 0; sentenceIdx < std::max<size_t>(1, miniBatchWords / maxLengthBreak); sentenceIdx++) {
+    source.appendSentence(sentenceIdx == 0 ? "" : "\n", wordRanges.begin(), wordRanges.end());
+    segments.push_back(segment);
+  }
+
+  // The Response is discarded, and the sentences are batched separately from
+  // those queued for translation.
+  ResponseBuilder responseBuilder(ResponseOptions(), std::move(source), vocabs_, [](Response &&) {});
+  Ptr<Request> request = New<Request>(/*requestId=*/0, std::move(segments), std::move(responseBuilder));
+  Batcher batcher(options_);
+  batcher.addWholeRequest(request);
+  Batch batch;
+  while (batcher >> batch) {
+    translateBatch(workerId, batch);
+  }
+}
+
+void TranslationModel::releaseReplica(size_t workerId) {
+  std::unique_ptr<BatchTranslator> translator;
+  {
+#ifndef WASM_COMPATIBLE_SOURCE
+    std::lock_guard<std::mutex> lock(replicas_[workerId].mutex);
+#endif
+    translator = std::move(replicas_[workerId].translator);
+  }
+  // translator (and with it graph and workspace) is destroyed here, without
+  // holding up the worker.
+}
+
+void TranslationModel::verifyModelChecksum(size_t numThreads) {
+  uint64_t checksum = computeChecksum(memory_.model, numThreads);
+  std::string expected = options_->get<std::string>("model-checksum", "");
+  if (expected.empty()) {
+    LOG(info, "Model checksum is {:016x}. Set --model-checksum to verify it on load.", checksum);
+    return;
+  }
+  uint64_t expectedChecksum;
+  ABORT_IF(!parseChecksum(expected, expectedChecksum),
+           "Invalid --model-checksum {}: expected 16 hexadecimal digits, as logged when none is given.", expected);
+  ABORT_IF(expectedChecksum != checksum,
+           "Model checksum mismatch: expected {}, computed {:016x}. Incomplete or corrupted download?", expected,
+           checksum);
+}
+
+}  // namespace bergamot
+}  // namespace marian
@@ -0,0 +1,158 @@
+#ifndef SRC_BERGAMOT_TRANSLATION_MODEL_H_
+#define SRC_BERGAMOT_TRANSLATION_MODEL_H_
+
+#include <future>
+#include <memory>
+#ifndef WASM_COMPATIBLE_SOURCE
+#include <mutex>
+#endif
+#include <string>
+#include <vector>
+
+#include "batch.h"
+#include "batch_translator.h"
+#include "batcher.h"
+#include "common/options.h"
+#include "data/shortlist.h"
+#include "definitions.h"
+#include "document_session.h"
+#include "passthrough_classifier.h"
+#include "request.h"
+#include "response.h"
+#include "response_options.h"
+#include "text_processor.h"
+#include "vocabs.h"
+
+namespace marian {
+namespace bergamot {
+
+/// A TranslationModel bundles everything specific to one model: the options and
+/// memories it is loaded from, vocabularies, text-processing, the shortlist
+/// generator and a Batcher holding sentences queued for translation with this
+/// model. It also holds one BatchTranslator (graph and scorers) per worker
+/// (replica), indexed by the worker's id.
+///
+/// Service holds the active TranslationModel through a shared pointer. A model
+/// that has been replaced (see Service::reload) stays alive while sentences
+/// queued on it are still being translated, and is released once they drain.
+class TranslationModel {
+ public:
+  /// Loads the model from options, or from memory when given, and initializes
+  /// the BatchTranslators of the first initializedReplicas replicas. The other
+  /// replicas are initialized on first use by their worker. Blocks until the
+  /// initialized replicas are ready to translate.
+  ///
+  /// @param [in] options: Marian options object.
+  /// @param [in] memory: holds all byte-array memories. Can be a set/subset of
+  /// model, shortlist, vocabs and ssplitPrefixFile bytes. Optional.
+  /// @param [in] replicas: number of workers that will translate with this
+  /// model.
+  /// @param [in] initializedReplicas: number of replicas to initialize
+  /// up front, at most replicas.
+  TranslationModel(Ptr<Options> options, MemoryBundle &&memory, size_t replicas, size_t initializedReplicas);
+
+  /// Processes source into sentences and constructs a Request from them, which
+  /// calls callback with the Response once all sentences are translated. If
+  /// session is given, sentences it keeps translations of are not translated
+  /// again, and the session is updated with the translations of source once
+  /// complete.
+  Ptr<Request> makeRequest(size_t requestId, AnnotatedText &&source, const ResponseOptions &responseOptions,
+                           CallbackType callback, DocumentSession *session = nullptr);
+
+  /// Constructs a Request from source already processed into sentences and
+  /// their segments (see process()).
+  Ptr<Request> makeRequest(size_t requestId, AnnotatedText &&source, Segments &&segments,
+                           const ResponseOptions &responseOptions, CallbackType callback);
+
+  /// Processes source into sentences, annotating them on source and adding
+  /// one segment per sentence to segments.
+  void process(AnnotatedText &source, Segments &segments) { textProcessor_.process(source, segments); }
+
+  /// Queues the sentences of request on this model's Batcher. Not thread-safe,
+  /// synchronized by the (aggregate) ThreadsafeBatcher.
+  void enqueueRequest(Ptr<Request> request) { batcher_.addWholeRequest(request); }
+
+  /// Generates a batch from sentences queued on this model. Returns false if no
+  /// sentences are queued. Not thread-safe, synchronized by the (aggregate)
+  /// ThreadsafeBatcher.
+  bool generateBatch(Batch &batch) { return batcher_ >> batch; }
+
+  /// Translates batch using the replica belonging to workerId, initializing
+  /// the replica first if necessary.
+  void translateBatch(size_t workerId, Batch &batch);
+
+  /// Initializes the replica belonging to workerId if necessary, and translates
+  /// a synthetic batch of mini-batch-words tokens on it, so that the first
+  /// real batch does not pay for allocating and first touching the workspace.
+  void warmup(size_t workerId);
+
+  /// Releases the replica belonging to workerId (graph, scorers and
+  /// workspace). It is initialized again on next use.
+  void releaseReplica(size_t workerId);
+
+  /// Returns if model is alignment capable or not.
+  bool isAlignmentSupported() const { return options_->hasAndNotEmpty("alignment"); }
+
+  /// Hits and misses of the source encoding cache of this model.
+  EncodingCache::Stats encodingCacheStats() const { return textProcessor_.encodingCacheStats(); }
+
+  /// Sentences classified and passed through untranslated by this model (see
+  /// --skip-translation).
+  PassthroughClassifier::Stats passthroughStats() const { return passthroughClassifier_.stats(); }
+
+ private:
+  /// Verifies the content of the model memory against the checksum given by
+  /// --model-checksum, hashing chunks on numThreads threads. Aborts on
+  /// mismatch.
+  void verifyModelChecksum(size_t numThreads);
+
+  /// Initializes the replica belonging to workerId if it is not yet. Expects
+  /// the replica's lock to be held.
+  BatchTranslator &replica(size_t workerId);
+
+  /// Options object holding the options the model was instantiated with.
+  Ptr<Options> options_;
+
+  /// Memories to load the model, shortlist and vocabs from, when passed as
+  /// bytes.
+  MemoryBundle memory_;  // ORDER DEPENDENCY (vocabs_, shortlistGenerator_, replicas_)
+
+  /// Store vocabs representing source and target.
+  Vocabs vocabs_;  // ORDER DEPENDENCY (textProcessor_, shortlistGenerator_)
+
+  /// TextProcesser takes a blob of text and converts into format consumable by
+  /// the batch-translator and annotates sentences and words.
+  TextProcessor textProcessor_;  // ORDER DEPENDENCY (vocabs_)
+
+  /// Picks out sentences to pass through untranslated, after textProcessor_
+  /// has split them.
+  PassthroughClassifier passthroughClassifier_;
+
+  /// Shortlist generator, constructed once and shared read-only among all
+  /// workers. Generating a shortlist does not mutate the generator, so
+  /// concurrent use from multiple workers is safe. nullptr if no shortlist is
+  /// configured.
+  Ptr<data::ShortlistGenerator const> shortlistGenerator_;  // ORDER DEPENDENCY (vocabs_, memory_)
+
+  /// Batcher handles generation of batches from requests on this model, subject
+  /// to packing-efficiency and priority optimization heuristics.
+  Batcher batcher_;
+
+  /// BatchTranslator of a worker, initialized on demand.
+  struct Replica {
+#ifndef WASM_COMPATIBLE_SOURCE
+    /// Normally only the worker uses its replica; the lock makes warmup() and
+    /// releaseReplica() safe to call from other threads.
+    std::mutex mutex;
+#endif
+    std::unique_ptr<BatchTranslator> translator;
+  };
+
+  /// One replica per worker, indexed by the worker's id.
+  std::vector<Replica> replicas_;
+};
+
+}  // namespace bergamot
+}  // namespace marian
+
+#endif  // SRC_BERGAMOT_TRANSLATION_MODEL_H_